@@ -0,0 +1,139 @@
+#ifndef HASHEDSPARSEVECTOR_HPP_
+#define HASHEDSPARSEVECTOR_HPP_
+
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include "SparseVector.hpp"
+
+// SparseVector that keeps an order-independent hash of its contents up to date. The hash is the
+// wrapping sum of a mixed hash of every (index, value) pair, so each modifier adjusts it in O(1)
+// by subtracting the old pair and adding the new one, and equal contents always hash equally no
+// matter how they were built. Element access is read-only; values change through insert(),
+// erase() or modify(), which is what lets the hash follow them.
+template<typename T, typename Hash = std::hash<T>>
+class HashedSparseVector {
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using const_reference = const T&;
+    using const_iterator = typename SparseVector<T>::const_iterator;
+
+  private:
+    SparseVector<T> values;
+    uint64_t fingerprint = 0;
+    Hash hasher;
+
+    // splitmix64 finaliser
+    static uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+        return x ^ (x >> 31);
+    }
+
+    uint64_t entry_hash(size_type pos, const T& value) const {
+        return mix(mix(pos) + static_cast<uint64_t>(hasher(value)));
+    }
+
+  public:
+    // Constructors
+    HashedSparseVector() = default;
+
+    explicit HashedSparseVector(SparseVector<T> source) : values(std::move(source)) {
+        for (auto it = values.cbegin(); it != values.cend(); ++it) {
+            fingerprint += entry_hash(it.index(), *it);
+        }
+    }
+
+    // Element access
+    const T& at(size_type pos) const { return values.at(pos); }
+    const T& operator[](size_type pos) const { return values[pos]; }
+
+    // The underlying container
+    const SparseVector<T>& storage() const { return values; }
+
+    // Iterators
+    const_iterator begin() const { return values.begin(); }
+    const_iterator end() const { return values.end(); }
+
+    // Capacity
+    bool empty() const { return values.empty(); }
+    size_type size() const { return values.size(); }
+
+    // Modifiers
+    void clear() {
+        values.clear();
+        fingerprint = 0;
+    }
+
+    void insert(size_type pos, const T& value) {
+        uint64_t added = entry_hash(pos, value);
+        uint64_t removed = values.contains(pos) ? entry_hash(pos, values[pos]) : 0;
+        values.insert(pos, value);
+        fingerprint += added - removed;
+    }
+
+    void erase(size_type pos) {
+        if (values.contains(pos)) {
+            fingerprint -= entry_hash(pos, values[pos]);
+            values.erase(pos);
+        }
+    }
+
+    // Calls f(value) on the value at pos, inserting a default value first if pos is empty, and
+    // rehashes the pair afterwards
+    template<typename F>
+    void modify(size_type pos, F f) {
+        if (values.contains(pos)) {
+            fingerprint -= entry_hash(pos, values[pos]);
+        } else {
+            values.insert(pos, T{});
+        }
+        T& value = values.at(pos);
+        try {
+            f(value);
+        } catch (...) {
+            fingerprint += entry_hash(pos, value);
+            throw;
+        }
+        fingerprint += entry_hash(pos, value);
+    }
+
+    // Lookup
+    bool contains(size_type pos) const { return values.contains(pos); }
+
+    // Order-independent hash of the (index, value) pairs, maintained incrementally
+    uint64_t hash() const { return fingerprint; }
+
+    // Rejects in O(1) when sizes or hashes differ, and only then compares element by element
+    bool operator==(const HashedSparseVector& other) const {
+        if (fingerprint != other.fingerprint || size() != other.size()) {
+            return false;
+        }
+        for (auto it = values.cbegin(); it != values.cend(); ++it) {
+            if (!other.values.contains(it.index()) || !(other.values[it.index()] == *it)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const HashedSparseVector& other) const { return !(*this == other); }
+
+    // Memory usage calculation
+    std::pair<size_t, size_t> memory_usage() const {
+        return values.memory_usage();
+    }
+};
+
+namespace std {
+template<typename T, typename Hash>
+struct hash<HashedSparseVector<T, Hash>> {
+    size_t operator()(const HashedSparseVector<T, Hash>& vector) const {
+        return static_cast<size_t>(vector.hash());
+    }
+};
+}  // namespace std
+
+#endif //HASHEDSPARSEVECTOR_HPP_
@@ -0,0 +1,260 @@
+#ifndef INTERNEDSPARSEVECTOR_HPP_
+#define INTERNEDSPARSEVECTOR_HPP_
+
+#include <vector>
+#include <optional>
+#include <stdexcept>
+#include <iterator>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <string>
+#include "SparseVector.hpp"
+
+// SparseVector variant for data with few distinct values: every distinct value is stored once
+// and each occupied index maps to the id of its value. Values are shared, so element access is
+// read-only and updates go through insert().
+template<typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>>
+class InternedSparseVector {
+  private:
+    std::vector<T> objects;
+    std::vector<uint32_t> ref_counts;
+    std::vector<uint32_t> free_ids;
+    std::vector<std::optional<uint32_t>> indices;
+    std::unordered_multimap<size_t, uint32_t> lookup;
+    size_t count = 0;
+    Hash hasher;
+    KeyEqual key_equal;
+
+    // Returns the id of value, storing it first if it has not been seen
+    uint32_t intern(const T& value) {
+        size_t hash = hasher(value);
+        auto [first, last] = lookup.equal_range(hash);
+        for (auto it = first; it != last; ++it) {
+            if (key_equal(objects[it->second], value)) {
+                ++ref_counts[it->second];
+                return it->second;
+            }
+        }
+
+        uint32_t id;
+        if (!free_ids.empty()) {
+            id = free_ids.back();
+            objects[id] = value;
+            free_ids.pop_back();
+        } else {
+            id = static_cast<uint32_t>(objects.size());
+            objects.push_back(value);
+            ref_counts.push_back(0);
+        }
+        lookup.emplace(hash, id);
+        ref_counts[id] = 1;
+        return id;
+    }
+
+    // Drops one reference to id, recycling the slot once nothing refers to it
+    void release(uint32_t id) {
+        if (--ref_counts[id] != 0) {
+            return;
+        }
+        auto [first, last] = lookup.equal_range(hasher(objects[id]));
+        for (auto it = first; it != last; ++it) {
+            if (it->second == id) {
+                lookup.erase(it);
+                break;
+            }
+        }
+        if constexpr (std::is_default_constructible<T>::value) {
+            objects[id] = T();
+        }
+        free_ids.push_back(id);
+    }
+
+    uint32_t checked_id(size_t pos) const {
+        if (pos >= indices.size() || !indices[pos].has_value()) {
+            throw std::out_of_range("InternedSparseVector::at: pos (which is "
+                                    + std::to_string(pos) + ") is not set");
+        }
+        return *indices[pos];
+    }
+
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using const_reference = const value_type&;
+    using const_pointer = const value_type*;
+
+    class Iterator {
+      private:
+        const InternedSparseVector* container;
+        size_t current_index;
+
+        void advance_to_valid() {
+            while (current_index < container->indices.size() && !container->indices[current_index].has_value()) {
+                ++current_index;
+            }
+        }
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = const T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = value_type*;
+        using reference = value_type&;
+
+        Iterator(const InternedSparseVector* cont, size_t index) : container(cont), current_index(index) {
+            advance_to_valid();
+        }
+
+        reference operator*() const {
+            return container->objects[*container->indices[current_index]];
+        }
+
+        pointer operator->() const {
+            return &(operator*());
+        }
+
+        // Sparse index of the current element
+        size_type index() const {
+            return current_index;
+        }
+
+        Iterator& operator++() {
+            ++current_index;
+            advance_to_valid();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return container == other.container && current_index == other.current_index;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator cbegin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, indices.size()); }
+    const_iterator cend() const { return const_iterator(this, indices.size()); }
+
+    // Constructors
+    InternedSparseVector() = default;
+    explicit InternedSparseVector(size_type n) : indices(n) {}
+
+    // Element access
+    const T& at(size_type pos) const {
+        return objects[checked_id(pos)];
+    }
+
+    const T& operator[](size_type pos) const {
+        return at(pos);
+    }
+
+    // Id of the value stored at pos; equal values always share an id
+    uint32_t value_id(size_type pos) const {
+        return checked_id(pos);
+    }
+
+    // Compares the values at two occupied indices by id
+    bool same_value(size_type a, size_type b) const {
+        return checked_id(a) == checked_id(b);
+    }
+
+    // Capacity
+    bool empty() const { return count == 0; }
+    size_type size() const { return count; }
+    // Number of distinct values currently referenced
+    size_type unique_size() const { return objects.size() - free_ids.size(); }
+    size_type max_size() const { return indices.max_size(); }
+
+    void shrink_to_fit() {
+        while (!indices.empty() && !indices.back().has_value()) {
+            indices.pop_back();
+        }
+        indices.shrink_to_fit();
+        free_ids.shrink_to_fit();
+    }
+
+    // Modifiers
+    void clear() {
+        objects.clear();
+        ref_counts.clear();
+        free_ids.clear();
+        indices.clear();
+        lookup.clear();
+        count = 0;
+    }
+
+    void insert(size_type pos, const T& value) {
+        if (pos >= indices.size()) {
+            indices.resize(pos + 1);
+        }
+        uint32_t id = intern(value);
+        if (indices[pos].has_value()) {
+            release(*indices[pos]);
+        } else {
+            ++count;
+        }
+        indices[pos] = id;
+    }
+
+    void erase(size_type pos) {
+        if (contains(pos)) {
+            release(*indices[pos]);
+            indices[pos] = std::nullopt;
+            --count;
+        }
+    }
+
+    void swap(InternedSparseVector& other) {
+        objects.swap(other.objects);
+        ref_counts.swap(other.ref_counts);
+        free_ids.swap(other.free_ids);
+        indices.swap(other.indices);
+        lookup.swap(other.lookup);
+        std::swap(count, other.count);
+        std::swap(hasher, other.hasher);
+        std::swap(key_equal, other.key_equal);
+    }
+
+    // Lookup
+    bool contains(size_type pos) const {
+        return (pos < indices.size() && indices[pos].has_value());
+    }
+
+    const_iterator find(size_type pos) const {
+        if (contains(pos)) {
+            return const_iterator(this, pos);
+        }
+        return end();
+    }
+
+    // Memory usage calculation: distinct values, then per-index and bookkeeping storage
+    std::pair<size_t, size_t> memory_usage() const {
+        size_t object_size = sizeof(T);
+        if constexpr (has_memory_usage<T>::value) {
+            object_size = T().memory_usage();
+        }
+        return {
+            objects.capacity() * object_size,
+            indices.capacity() * sizeof(std::optional<uint32_t>)
+                + (ref_counts.capacity() + free_ids.capacity()) * sizeof(uint32_t)
+                + lookup.size() * (sizeof(size_t) + sizeof(uint32_t) + sizeof(void*))
+                + lookup.bucket_count() * sizeof(void*)
+        };
+    }
+};
+
+#endif //INTERNEDSPARSEVECTOR_HPP_
@@ -0,0 +1,358 @@
+#ifndef MVCCSPARSEVECTOR_HPP_
+#define MVCCSPARSEVECTOR_HPP_
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+// Sparse container with multi-version concurrency control: readers take a Snapshot and see the
+// contents as of that version while writers keep committing newer ones.
+//
+// Each index has a chain of versions, newest first, whose head pointer lives in a page of atomic
+// slots. Pages never move; the page directory is replaced when it grows and the old one is kept
+// until destruction, so readers walk directory, page and chain without taking any lock. Writers
+// are serialised by a mutex, link the new versions of a commit first and only then advance the
+// published version, so a snapshot never sees part of a commit. Snapshots register their version
+// under a separate mutex, and collect() frees versions older than every one that a registered
+// snapshot can still reach.
+template<typename T>
+class MvccSparseVector {
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using version_type = uint64_t;
+
+  private:
+    struct Version {
+        version_type version;
+        bool erased;
+        T value;
+        Version* older;
+    };
+
+    static constexpr unsigned page_bits = 12;
+    static constexpr size_t page_size = size_t{1} << page_bits;
+
+    struct Page {
+        std::atomic<Version*> slots[page_size] = {};
+    };
+
+    struct Directory {
+        size_t page_count;
+        std::unique_ptr<std::atomic<Page*>[]> pages;
+
+        explicit Directory(size_t count) : page_count(count), pages(new std::atomic<Page*>[count]) {
+            for (size_t i = 0; i < count; ++i) {
+                pages[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::atomic<Directory*> directory;
+    std::atomic<version_type> published{0};
+    std::atomic<size_t> count{0};
+
+    // Writer state
+    std::mutex writer_mutex;
+    std::vector<std::unique_ptr<Directory>> directories;  // current one last
+    std::vector<std::unique_ptr<Page>> pages;
+    std::vector<size_t> chained;  // indices holding more than one version
+    size_t live_versions = 0;
+
+    // Registered snapshot versions and how many snapshots hold each
+    mutable std::mutex readers_mutex;
+    mutable std::map<version_type, size_t> active;
+
+    // Writes between automatic collect() calls
+    static constexpr size_t collect_interval = 1024;
+    size_t writes_since_collect = 0;
+
+    // Newest version of pos no newer than at, or nullptr
+    const Version* find_version(size_t pos, version_type at) const {
+        const Directory* dir = directory.load(std::memory_order_acquire);
+        size_t page_index = pos >> page_bits;
+        if (page_index >= dir->page_count) {
+            return nullptr;
+        }
+        const Page* page = dir->pages[page_index].load(std::memory_order_acquire);
+        if (page == nullptr) {
+            return nullptr;
+        }
+        const Version* node = page->slots[pos & (page_size - 1)].load(std::memory_order_acquire);
+        while (node != nullptr && node->version > at) {
+            node = node->older;
+        }
+        return node;
+    }
+
+    std::atomic<Version*>& slot_for_write(size_t pos) {
+        size_t page_index = pos >> page_bits;
+        Directory* dir = directories.back().get();
+        if (page_index >= dir->page_count) {
+            auto grown = std::make_unique<Directory>(std::max(page_index + 1, dir->page_count * 2));
+            for (size_t i = 0; i < dir->page_count; ++i) {
+                grown->pages[i].store(dir->pages[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            directories.push_back(std::move(grown));
+            dir = directories.back().get();
+            directory.store(dir, std::memory_order_release);
+        }
+        Page* page = dir->pages[page_index].load(std::memory_order_relaxed);
+        if (page == nullptr) {
+            pages.push_back(std::make_unique<Page>());
+            page = pages.back().get();
+            dir->pages[page_index].store(page, std::memory_order_release);
+        }
+        return page->slots[pos & (page_size - 1)];
+    }
+
+    // Makes node the newest version of pos; the caller publishes it. An erase marker for an index
+    // that holds no value is dropped instead. Returns whether pos held a value before. Never
+    // throws, given that the page of pos exists and chained has room for one more index.
+    bool link(size_t pos, Version* node) noexcept {
+        std::atomic<Version*>& slot = directories.back()->pages[pos >> page_bits].load(std::memory_order_relaxed)
+                                          ->slots[pos & (page_size - 1)];
+        Version* head = slot.load(std::memory_order_relaxed);
+        bool was_live = head != nullptr && !head->erased;
+        if (node->erased && !was_live) {
+            delete node;
+            return false;
+        }
+        if (head != nullptr && head->older == nullptr) {
+            chained.push_back(pos);
+        }
+        node->older = head;
+        ++live_versions;
+        slot.store(node, std::memory_order_release);
+        return was_live;
+    }
+
+    version_type oldest_active() const {
+        std::lock_guard<std::mutex> lock(readers_mutex);
+        return active.empty() ? published.load(std::memory_order_acquire) : active.begin()->first;
+    }
+
+    size_t collect_locked() {
+        writes_since_collect = 0;
+        version_type horizon = oldest_active();
+        size_t freed = 0;
+        size_t kept = 0;
+        for (size_t pos : chained) {
+            Version* head = slot_for_write(pos).load(std::memory_order_relaxed);
+            Version* node = head;
+            // Readers stop at the newest version no newer than their snapshot, so nothing past the
+            // first version visible at the horizon can be reached
+            while (node != nullptr && node->version > horizon) {
+                node = node->older;
+            }
+            if (node == nullptr) {
+                chained[kept++] = pos;
+                continue;
+            }
+            Version* garbage = node->older;
+            node->older = nullptr;
+            while (garbage != nullptr) {
+                Version* older = garbage->older;
+                delete garbage;
+                --live_versions;
+                ++freed;
+                garbage = older;
+            }
+            if (head->older != nullptr) {
+                chained[kept++] = pos;
+            }
+        }
+        chained.resize(kept);
+        return freed;
+    }
+
+    void after_write() {
+        if (++writes_since_collect >= collect_interval) {
+            collect_locked();
+        }
+    }
+
+  public:
+    // Read-only view of the contents as of one version. Keeps every version it can see alive
+    // until it is destroyed; reads through it take no locks.
+    class Snapshot {
+      private:
+        const MvccSparseVector* owner;
+        version_type snapshot_version;
+
+        friend class MvccSparseVector;
+        Snapshot(const MvccSparseVector* owner, version_type version)
+            : owner(owner), snapshot_version(version) {}
+
+      public:
+        Snapshot(Snapshot&& other) noexcept : owner(other.owner), snapshot_version(other.snapshot_version) {
+            other.owner = nullptr;
+        }
+
+        Snapshot& operator=(Snapshot&& other) noexcept {
+            if (this != &other) {
+                release();
+                owner = other.owner;
+                snapshot_version = other.snapshot_version;
+                other.owner = nullptr;
+            }
+            return *this;
+        }
+
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+
+        ~Snapshot() { release(); }
+
+        // Unregisters the snapshot; it must not be read afterwards
+        void release() {
+            if (owner != nullptr) {
+                std::lock_guard<std::mutex> lock(owner->readers_mutex);
+                auto it = owner->active.find(snapshot_version);
+                if (--it->second == 0) {
+                    owner->active.erase(it);
+                }
+                owner = nullptr;
+            }
+        }
+
+        version_type version() const { return snapshot_version; }
+
+        // Pointer to the value at pos as of this snapshot, or nullptr
+        const T* find(size_type pos) const {
+            const Version* node = owner->find_version(pos, snapshot_version);
+            return node != nullptr && !node->erased ? &node->value : nullptr;
+        }
+
+        bool contains(size_type pos) const { return find(pos) != nullptr; }
+
+        const T& at(size_type pos) const {
+            const T* value = find(pos);
+            if (value == nullptr) {
+                throw std::out_of_range("MvccSparseVector::Snapshot::at: index " + std::to_string(pos)
+                                        + " is not present at version " + std::to_string(snapshot_version));
+            }
+            return *value;
+        }
+
+        // Calls f(index, value) for every value present as of this snapshot, in index order
+        template<typename F>
+        void for_each(F f) const {
+            const Directory* dir = owner->directory.load(std::memory_order_acquire);
+            for (size_t p = 0; p < dir->page_count; ++p) {
+                if (dir->pages[p].load(std::memory_order_acquire) == nullptr) {
+                    continue;
+                }
+                for (size_t i = 0; i < page_size; ++i) {
+                    size_t pos = (p << page_bits) | i;
+                    if (const T* value = find(pos)) {
+                        f(pos, *value);
+                    }
+                }
+            }
+        }
+    };
+
+    // Constructors
+    MvccSparseVector() {
+        directories.push_back(std::make_unique<Directory>(1));
+        directory.store(directories.back().get(), std::memory_order_release);
+    }
+
+    MvccSparseVector(const MvccSparseVector&) = delete;
+    MvccSparseVector& operator=(const MvccSparseVector&) = delete;
+
+    ~MvccSparseVector() {
+        for (auto& page : pages) {
+            for (auto& slot : page->slots) {
+                Version* node = slot.load(std::memory_order_relaxed);
+                while (node != nullptr) {
+                    Version* older = node->older;
+                    delete node;
+                    node = older;
+                }
+            }
+        }
+    }
+
+    // Registers a snapshot of the latest published version
+    Snapshot snapshot() const {
+        std::lock_guard<std::mutex> lock(readers_mutex);
+        version_type at = published.load(std::memory_order_acquire);
+        ++active[at];
+        return Snapshot(this, at);
+    }
+
+    // Latest published version
+    version_type version() const { return published.load(std::memory_order_acquire); }
+
+    // Number of values present at the latest version
+    size_type size() const { return count.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+
+    // Modifiers; each commits a new version and returns it
+    version_type insert(size_type pos, T value) {
+        std::vector<std::pair<size_type, std::optional<T>>> changes;
+        changes.emplace_back(pos, std::move(value));
+        return commit(std::move(changes));
+    }
+
+    version_type erase(size_type pos) {
+        std::vector<std::pair<size_type, std::optional<T>>> changes;
+        changes.emplace_back(pos, std::nullopt);
+        return commit(std::move(changes));
+    }
+
+    // Commits several changes as one version; an empty optional erases the index. Later changes
+    // to an index win over earlier ones. All versions and pages are allocated before the first
+    // one is linked, so a commit that throws leaves nothing behind.
+    version_type commit(std::vector<std::pair<size_type, std::optional<T>>> changes) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        version_type next = published.load(std::memory_order_relaxed) + 1;
+        std::vector<std::unique_ptr<Version>> nodes;
+        nodes.reserve(changes.size());
+        for (auto& [pos, value] : changes) {
+            slot_for_write(pos);
+            nodes.push_back(value.has_value()
+                            ? std::make_unique<Version>(Version{next, false, std::move(*value), nullptr})
+                            : std::make_unique<Version>(Version{next, true, T{}, nullptr}));
+        }
+        chained.reserve(chained.size() + changes.size());
+
+        size_t live = count.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < changes.size(); ++i) {
+            bool inserting = !nodes[i]->erased;
+            bool was_live = link(changes[i].first, nodes[i].release());
+            live += (inserting && !was_live) ? 1 : 0;
+            live -= (!inserting && was_live) ? 1 : 0;
+        }
+        count.store(live, std::memory_order_relaxed);
+        published.store(next, std::memory_order_release);
+        after_write();
+        return next;
+    }
+
+    // Frees every version no registered snapshot can reach and returns how many were freed.
+    // Writers also call this every few writes.
+    size_t collect() {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        return collect_locked();
+    }
+
+    // Number of stored versions across all indices, including erase markers
+    size_t version_count() {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        return live_versions;
+    }
+};
+
+#endif //MVCCSPARSEVECTOR_HPP_
@@ -0,0 +1,417 @@
+#ifndef QUANTIZEDSPARSEVECTOR_HPP_
+#define QUANTIZEDSPARSEVECTOR_HPP_
+
+#include <vector>
+#include <optional>
+#include <stdexcept>
+#include <iterator>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+// Value encodings for QuantizedSparseVector. Each provides encode/decode of a single value and a
+// decode_block used by passes in slot order such as sum(). Block scaled encodings share one float
+// scale per block_size consecutive stored values; the others ignore the scale argument.
+
+// IEEE 754 half precision, round to nearest even. Uses F16C instructions when compiled for them.
+struct Fp16Encoding {
+    using code_type = uint16_t;
+    static constexpr bool block_scaled = false;
+
+    static code_type encode(float value, float = 1.0f) {
+#if defined(__F16C__)
+        return static_cast<code_type>(_cvtss_sh(value, 0));
+#else
+        uint32_t x;
+        std::memcpy(&x, &value, sizeof(x));
+        uint32_t sign = (x >> 16) & 0x8000;
+        x &= 0x7fffffff;
+        if (x >= 0x7f800000) {
+            return static_cast<code_type>(sign | (x > 0x7f800000 ? 0x7e00 : 0x7c00));
+        }
+        if (x >= 0x477ff000) {
+            return static_cast<code_type>(sign | 0x7c00);  // rounds past the largest half
+        }
+        if (x < 0x38800000) {
+            // Subnormal half: shift the full mantissa into place and round
+            if (x < 0x33000000) {
+                return static_cast<code_type>(sign);
+            }
+            uint32_t mantissa = (x & 0x7fffff) | 0x800000;
+            uint32_t shift = 126 - (x >> 23);
+            uint32_t result = mantissa >> shift;
+            uint32_t remainder = mantissa & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+            if (remainder > halfway || (remainder == halfway && (result & 1))) {
+                ++result;
+            }
+            return static_cast<code_type>(sign | result);
+        }
+        // Rebias the exponent and round the mantissa to 10 bits
+        return static_cast<code_type>(sign | ((x + 0xc8000fff + ((x >> 13) & 1)) >> 13));
+#endif
+    }
+
+    static float decode(code_type code, float = 1.0f) {
+#if defined(__F16C__)
+        return _cvtsh_ss(code);
+#else
+        uint32_t sign = static_cast<uint32_t>(code & 0x8000) << 16;
+        uint32_t exponent = (code >> 10) & 0x1f;
+        uint32_t mantissa = code & 0x3ff;
+        uint32_t bits;
+        if (exponent == 0) {
+            float magnitude = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+            return sign ? -magnitude : magnitude;
+        } else if (exponent == 31) {
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        } else {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+#endif
+    }
+
+    static void decode_block(const code_type* codes, size_t n, float, float* out) {
+        size_t i = 0;
+#if defined(__F16C__)
+        for (; i + 8 <= n; i += 8) {
+            __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + i));
+            _mm256_storeu_ps(out + i, _mm256_cvtph_ps(half));
+        }
+#endif
+        for (; i < n; ++i) {
+            out[i] = decode(codes[i]);
+        }
+    }
+};
+
+// bfloat16: the top half of a float, round to nearest even
+struct Bf16Encoding {
+    using code_type = uint16_t;
+    static constexpr bool block_scaled = false;
+
+    static code_type encode(float value, float = 1.0f) {
+        uint32_t x;
+        std::memcpy(&x, &value, sizeof(x));
+        if ((x & 0x7fffffff) > 0x7f800000) {
+            return static_cast<code_type>((x >> 16) | 0x40);  // keep NaNs quiet
+        }
+        return static_cast<code_type>((x + 0x7fff + ((x >> 16) & 1)) >> 16);
+    }
+
+    static float decode(code_type code, float = 1.0f) {
+        uint32_t bits = static_cast<uint32_t>(code) << 16;
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Plain shifts, which compilers vectorise
+    static void decode_block(const code_type* codes, size_t n, float, float* out) {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = decode(codes[i]);
+        }
+    }
+};
+
+// Signed 8-bit codes with one scale per block of 64 stored values: value = code * scale
+struct Int8BlockEncoding {
+    using code_type = int8_t;
+    static constexpr bool block_scaled = true;
+    static constexpr size_t block_size = 64;
+
+    static float scale_for(float max_abs) {
+        return max_abs / 127.0f;
+    }
+
+    static code_type encode(float value, float scale) {
+        if (scale == 0.0f) {
+            return 0;
+        }
+        float code = std::nearbyint(value / scale);
+        return static_cast<code_type>(std::clamp(code, -127.0f, 127.0f));
+    }
+
+    static float decode(code_type code, float scale) {
+        return static_cast<float>(code) * scale;
+    }
+
+    static void decode_block(const code_type* codes, size_t n, float scale, float* out) {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = static_cast<float>(codes[i]) * scale;
+        }
+    }
+};
+
+// SparseVector<float> that stores values in a reduced precision Encoding. Values are decoded on
+// access and written through insert(); bulk operations decode whole blocks at a time.
+template<typename Encoding>
+class QuantizedSparseVector {
+  private:
+    using code_type = typename Encoding::code_type;
+
+    // Bulk decoding works in blocks that never straddle two scales
+    static constexpr size_t decode_block_size() {
+        if constexpr (Encoding::block_scaled) {
+            return Encoding::block_size;
+        } else {
+            return 64;
+        }
+    }
+
+    std::vector<code_type> codes;
+    std::vector<float> scales;
+    std::vector<std::optional<uint32_t>> indices;
+
+    float scale_of(size_t slot) const {
+        if constexpr (Encoding::block_scaled) {
+            return scales[slot / Encoding::block_size];
+        } else {
+            return 1.0f;
+        }
+    }
+
+    float decode_slot(size_t slot) const {
+        return Encoding::decode(codes[slot], scale_of(slot));
+    }
+
+    // Stores value at slot; for block scaled encodings a value outside the block's range widens
+    // the scale and requantises the rest of the block
+    void encode_slot(size_t slot, float value) {
+        if constexpr (Encoding::block_scaled) {
+            size_t block = slot / Encoding::block_size;
+            if (block >= scales.size()) {
+                scales.resize(block + 1, 0.0f);
+            }
+            float& scale = scales[block];
+            float needed = Encoding::scale_for(std::fabs(value));
+            if (needed > scale) {
+                size_t first = block * Encoding::block_size;
+                size_t last = std::min(codes.size(), first + Encoding::block_size);
+                for (size_t i = first; i < last; ++i) {
+                    if (i != slot) {
+                        codes[i] = Encoding::encode(Encoding::decode(codes[i], scale), needed);
+                    }
+                }
+                scale = needed;
+            }
+            codes[slot] = Encoding::encode(value, scale);
+        } else {
+            codes[slot] = Encoding::encode(value);
+        }
+    }
+
+    // Calls f(slot, value) for every stored value, decoding a block at a time
+    template<typename F>
+    void for_each_decoded(F&& f) const {
+        float buffer[decode_block_size()];
+        for (size_t first = 0; first < codes.size(); first += decode_block_size()) {
+            size_t n = std::min(decode_block_size(), codes.size() - first);
+            Encoding::decode_block(codes.data() + first, n, scale_of(first), buffer);
+            for (size_t i = 0; i < n; ++i) {
+                f(first + i, buffer[i]);
+            }
+        }
+    }
+
+  public:
+    using value_type = float;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using encoding_type = Encoding;
+
+    class Iterator {
+      private:
+        const QuantizedSparseVector* container;
+        size_t current_index;
+
+        void advance_to_valid() {
+            while (current_index < container->indices.size() && !container->indices[current_index].has_value()) {
+                ++current_index;
+            }
+        }
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = float;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = float;
+
+        Iterator(const QuantizedSparseVector* cont, size_t index) : container(cont), current_index(index) {
+            advance_to_valid();
+        }
+
+        reference operator*() const {
+            return container->decode_slot(*container->indices[current_index]);
+        }
+
+        // Sparse index of the current element
+        size_type index() const {
+            return current_index;
+        }
+
+        Iterator& operator++() {
+            ++current_index;
+            advance_to_valid();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return container == other.container && current_index == other.current_index;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator cbegin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, indices.size()); }
+    const_iterator cend() const { return const_iterator(this, indices.size()); }
+
+    // Constructors
+    QuantizedSparseVector() = default;
+    explicit QuantizedSparseVector(size_type n) : indices(n) {}
+
+    // Element access
+    float at(size_type pos) const {
+        if (pos >= indices.size() || !indices[pos].has_value()) {
+            throw std::out_of_range("QuantizedSparseVector::at: pos (which is "
+                                    + std::to_string(pos) + ") is not set");
+        }
+        return decode_slot(*indices[pos]);
+    }
+
+    float operator[](size_type pos) const {
+        return at(pos);
+    }
+
+    // Capacity
+    bool empty() const { return codes.empty(); }
+    size_type size() const { return codes.size(); }
+    size_type max_size() const { return indices.max_size(); }
+
+    void reserve(size_type count) {
+        codes.reserve(count);
+    }
+
+    void shrink_to_fit() {
+        codes.shrink_to_fit();
+        scales.shrink_to_fit();
+        while (!indices.empty() && !indices.back().has_value()) {
+            indices.pop_back();
+        }
+        indices.shrink_to_fit();
+    }
+
+    // Modifiers
+    void clear() {
+        codes.clear();
+        scales.clear();
+        indices.clear();
+    }
+
+    void insert(size_type pos, float value) {
+        if (pos >= indices.size()) {
+            indices.resize(pos + 1);
+        }
+        if (!indices[pos].has_value()) {
+            indices[pos] = static_cast<uint32_t>(codes.size());
+            codes.push_back(0);
+        }
+        encode_slot(*indices[pos], value);
+    }
+
+    void erase(size_type pos) {
+        if (!contains(pos)) {
+            return;
+        }
+        // Move the last stored value into the hole so storage stays dense. No reverse map is kept
+        // (it would cost more than the values save), so the owner of the last slot is found by
+        // scanning the index, as SparseVector::erase() does to renumber.
+        uint32_t slot = *indices[pos];
+        uint32_t last = static_cast<uint32_t>(codes.size() - 1);
+        indices[pos] = std::nullopt;
+        if (slot != last) {
+            for (auto& index : indices) {
+                if (index == last) {
+                    index = slot;
+                    break;
+                }
+            }
+            encode_slot(slot, decode_slot(last));
+        }
+        codes.pop_back();
+        if constexpr (Encoding::block_scaled) {
+            scales.resize((codes.size() + Encoding::block_size - 1) / Encoding::block_size);
+        }
+    }
+
+    void swap(QuantizedSparseVector& other) {
+        codes.swap(other.codes);
+        scales.swap(other.scales);
+        indices.swap(other.indices);
+    }
+
+    // Lookup
+    bool contains(size_type pos) const {
+        return (pos < indices.size() && indices[pos].has_value());
+    }
+
+    const_iterator find(size_type pos) const {
+        if (contains(pos)) {
+            return const_iterator(this, pos);
+        }
+        return end();
+    }
+
+    // Bulk operations
+    float sum() const {
+        float total = 0.0f;
+        for_each_decoded([&](size_t, float value) { total += value; });
+        return total;
+    }
+
+    // Dot product with a dense vector indexed the same way; walks the index in key order so the
+    // dense vector is read sequentially, decoding one value at a time (slots are visited in key
+    // order, not block order, so decode_block does not apply)
+    float dot(const std::vector<float>& dense) const {
+        float total = 0.0f;
+        size_t n = std::min(indices.size(), dense.size());
+        for (size_t key = 0; key < n; ++key) {
+            if (indices[key].has_value()) {
+                total += decode_slot(*indices[key]) * dense[key];
+            }
+        }
+        return total;
+    }
+
+    // Memory usage calculation: encoded values and scales, then index storage
+    std::pair<size_t, size_t> memory_usage() const {
+        return {
+            codes.capacity() * sizeof(code_type) + scales.capacity() * sizeof(float),
+            indices.capacity() * sizeof(std::optional<uint32_t>)
+        };
+    }
+};
+
+#endif //QUANTIZEDSPARSEVECTOR_HPP_
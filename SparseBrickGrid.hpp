@@ -0,0 +1,188 @@
+#ifndef SPARSEBRICKGRID_HPP_
+#define SPARSEBRICKGRID_HPP_
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "SparseSet.hpp"
+#include "SparseGrid.hpp"
+
+// Sparse 3D voxel storage in the style of VDB: space is tiled into 8x8x8 bricks, only bricks that
+// hold an active voxel are stored, and each brick keeps a dense payload plus an occupancy mask.
+// Bricks are found through a Morton ordered SparseGrid, and within a brick voxels are laid out x
+// fastest, so stencils over a neighbourhood read a few contiguous blocks of memory.
+template<typename T>
+class SparseBrickGrid {
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using coord_type = std::array<uint32_t, 3>;
+
+    static constexpr uint32_t brick_shift = 3;
+    static constexpr uint32_t brick_side = 1u << brick_shift;
+    static constexpr size_t brick_volume = size_t{brick_side} * brick_side * brick_side;
+
+    struct Brick {
+        std::array<uint64_t, brick_volume / 64> mask{};
+        std::array<T, brick_volume> values{};
+
+        bool active(size_t offset) const {
+            return (mask[offset / 64] >> (offset % 64)) & 1;
+        }
+
+        size_t active_count() const {
+            size_t count = 0;
+            for (uint64_t word : mask) {
+                count += sparse_bits::popcount(word);
+            }
+            return count;
+        }
+    };
+
+    // Largest voxel coordinate on any axis (2^24 - 1), set by the brick coordinates the grid can key
+    static constexpr uint32_t max_coordinate =
+        static_cast<uint32_t>(((uint64_t{SparseGrid<Brick, 3>::max_coordinate} + 1) << brick_shift) - 1);
+
+  private:
+    SparseGrid<Brick, 3> bricks;
+    size_t active_voxels = 0;
+
+    static coord_type brick_coord(const coord_type& coord) {
+        return {coord[0] >> brick_shift, coord[1] >> brick_shift, coord[2] >> brick_shift};
+    }
+
+    // Position of a voxel within its brick, x fastest
+    static size_t local_offset(const coord_type& coord) {
+        constexpr uint32_t local_mask = brick_side - 1;
+        return (coord[0] & local_mask) + brick_side * ((coord[1] & local_mask) + brick_side * (coord[2] & local_mask));
+    }
+
+    static bool storable(const coord_type& coord) {
+        return coord[0] <= max_coordinate && coord[1] <= max_coordinate && coord[2] <= max_coordinate;
+    }
+
+    // Voxels beyond max_coordinate can never be stored, so lookups treat them as inactive
+    const Brick* find_brick(const coord_type& brick) const {
+        constexpr uint32_t largest = max_coordinate >> brick_shift;
+        if (brick[0] > largest || brick[1] > largest || brick[2] > largest) {
+            return nullptr;
+        }
+        return bricks.contains(brick) ? &bricks[brick] : nullptr;
+    }
+
+  public:
+    // Constructors
+    SparseBrickGrid() = default;
+
+    // Element access
+    const T& at(const coord_type& coord) const {
+        const T* value = find(coord);
+        if (value == nullptr) {
+            throw std::out_of_range("SparseBrickGrid::at: voxel (" + std::to_string(coord[0]) + ", "
+                                    + std::to_string(coord[1]) + ", " + std::to_string(coord[2]) + ") is not active");
+        }
+        return *value;
+    }
+
+    // Value of an active voxel, or background for inactive ones
+    T value_or(const coord_type& coord, const T& background) const {
+        const T* value = find(coord);
+        return value != nullptr ? *value : background;
+    }
+
+    // Capacity
+    bool empty() const { return active_voxels == 0; }
+    size_type size() const { return active_voxels; }
+    size_type brick_count() const { return bricks.size(); }
+
+    // Modifiers
+    void clear() {
+        bricks.clear();
+        active_voxels = 0;
+    }
+
+    void insert(const coord_type& coord, const T& value) {
+        if (!storable(coord)) {
+            throw std::out_of_range("SparseBrickGrid::insert: voxel (" + std::to_string(coord[0]) + ", "
+                                    + std::to_string(coord[1]) + ", " + std::to_string(coord[2])
+                                    + ") exceeds the largest coordinate " + std::to_string(max_coordinate)
+                                    + " (coordinates must be below 2^24)");
+        }
+        Brick& brick = bricks[brick_coord(coord)];
+        size_t offset = local_offset(coord);
+        if (!brick.active(offset)) {
+            brick.mask[offset / 64] |= uint64_t{1} << (offset % 64);
+            ++active_voxels;
+        }
+        brick.values[offset] = value;
+    }
+
+    // Deactivates a voxel, dropping its brick once the brick is empty
+    void erase(const coord_type& coord) {
+        coord_type brick_key = brick_coord(coord);
+        if (find_brick(brick_key) == nullptr) {
+            return;
+        }
+        Brick& brick = bricks[brick_key];
+        size_t offset = local_offset(coord);
+        if (!brick.active(offset)) {
+            return;
+        }
+        brick.mask[offset / 64] &= ~(uint64_t{1} << (offset % 64));
+        brick.values[offset] = T{};
+        --active_voxels;
+        if (brick.active_count() == 0) {
+            bricks.erase(brick_key);
+        }
+    }
+
+    // Lookup
+    bool contains(const coord_type& coord) const {
+        return find(coord) != nullptr;
+    }
+
+    // Pointer to the value of an active voxel, or nullptr
+    const T* find(const coord_type& coord) const {
+        const Brick* brick = find_brick(brick_coord(coord));
+        size_t offset = local_offset(coord);
+        return brick != nullptr && brick->active(offset) ? &brick->values[offset] : nullptr;
+    }
+
+    // The brick containing a voxel, or nullptr if it holds no active voxels
+    const Brick* brick_at(const coord_type& coord) const {
+        return find_brick(brick_coord(coord));
+    }
+
+    // Calls f(origin, brick) for every stored brick in Morton order, origin being its lowest voxel
+    template<typename F>
+    void for_each_brick(F f) const {
+        bricks.for_each([&](const coord_type& brick, const Brick& data) {
+            f(coord_type{brick[0] << brick_shift, brick[1] << brick_shift, brick[2] << brick_shift}, data);
+        });
+    }
+
+    // Calls f(coord, value) for every active voxel, brick by brick
+    template<typename F>
+    void for_each(F f) const {
+        for_each_brick([&](const coord_type& origin, const Brick& brick) {
+            for (size_t word = 0; word < brick.mask.size(); ++word) {
+                for (uint64_t bits = brick.mask[word]; bits != 0; bits &= bits - 1) {
+                    size_t offset = word * 64 + sparse_bits::countr_zero(bits);
+                    coord_type coord{origin[0] + static_cast<uint32_t>(offset % brick_side),
+                                     origin[1] + static_cast<uint32_t>((offset / brick_side) % brick_side),
+                                     origin[2] + static_cast<uint32_t>(offset / (brick_side * brick_side))};
+                    f(coord, brick.values[offset]);
+                }
+            }
+        });
+    }
+
+    // Memory usage calculation
+    std::pair<size_t, size_t> memory_usage() const {
+        return bricks.memory_usage();
+    }
+};
+
+#endif //SPARSEBRICKGRID_HPP_
@@ -0,0 +1,197 @@
+#ifndef SPARSEGRAPH_HPP_
+#define SPARSEGRAPH_HPP_
+
+#include <vector>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "SparseVector.hpp"
+#include "SparseParallel.hpp"
+
+// Directed graph in compressed sparse row (CSR) form over sparse vertex keys. Vertices get dense
+// ids in key order through a SparseVector, and the out-neighbours of vertex id v are
+// neighbours[offsets[v], offsets[v + 1]), so traversals stream through two flat arrays instead of
+// chasing one heap allocation per vertex.
+class SparseGraph {
+  public:
+    using size_type = std::size_t;
+    using vertex_id = uint32_t;
+
+    // Contiguous run of neighbour ids
+    struct NeighborRange {
+        const vertex_id* first;
+        const vertex_id* last;
+
+        const vertex_id* begin() const { return first; }
+        const vertex_id* end() const { return last; }
+        size_type size() const { return static_cast<size_type>(last - first); }
+        bool empty() const { return first == last; }
+    };
+
+  private:
+    friend class SparseGraphBuilder;
+
+    SparseVector<vertex_id> vertex_ids;
+    std::vector<size_type> vertex_keys;
+    std::vector<size_type> offsets{0};
+    std::vector<vertex_id> neighbours;
+
+  public:
+    SparseGraph() = default;
+
+    size_type vertex_count() const { return vertex_keys.size(); }
+    size_type edge_count() const { return neighbours.size(); }
+
+    bool contains(size_type key) const { return vertex_ids.contains(key); }
+
+    // Dense id of a vertex key and back
+    vertex_id id_of(size_type key) const {
+        if (!vertex_ids.contains(key)) {
+            throw std::out_of_range("SparseGraph::id_of: vertex " + std::to_string(key) + " is not in the graph");
+        }
+        return vertex_ids[key];
+    }
+
+    size_type key_of(vertex_id id) const { return vertex_keys.at(id); }
+
+    // Out-neighbours of the vertex with dense id
+    NeighborRange neighbors_of_id(vertex_id id) const {
+        return {neighbours.data() + offsets[id], neighbours.data() + offsets[id + 1]};
+    }
+
+    // Out-neighbours (as dense ids) of the vertex with key
+    NeighborRange neighbors(size_type key) const {
+        return neighbors_of_id(id_of(key));
+    }
+
+    size_type degree(size_type key) const { return neighbors(key).size(); }
+
+    // Calls f(key) for every out-neighbour of the vertex with key
+    template<typename F>
+    void for_each_neighbor(size_type key, F f) const {
+        for (vertex_id id : neighbors(key)) {
+            f(vertex_keys[id]);
+        }
+    }
+
+    // Breadth-first traversal from source, calling visit(key, depth) for each reachable vertex in
+    // order of depth
+    template<typename F>
+    void bfs(size_type source, F visit) const {
+        constexpr uint32_t unvisited = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> depth(vertex_count(), unvisited);
+        std::vector<vertex_id> frontier{id_of(source)};
+        std::vector<vertex_id> next;
+        depth[frontier.front()] = 0;
+        for (uint32_t level = 0; !frontier.empty(); ++level) {
+            next.clear();
+            for (vertex_id v : frontier) {
+                visit(vertex_keys[v], level);
+                for (vertex_id w : neighbors_of_id(v)) {
+                    if (depth[w] == unvisited) {
+                        depth[w] = level + 1;
+                        next.push_back(w);
+                    }
+                }
+            }
+            frontier.swap(next);
+        }
+    }
+
+    // Memory usage calculation: adjacency arrays, then the vertex key index
+    std::pair<size_t, size_t> memory_usage() const {
+        auto [ids_objects, ids_indices] = vertex_ids.memory_usage();
+        return {
+            offsets.capacity() * sizeof(size_type) + neighbours.capacity() * sizeof(vertex_id),
+            ids_objects + ids_indices + vertex_keys.capacity() * sizeof(size_type)
+        };
+    }
+};
+
+// Accumulates edges between sparse vertex keys and finalises them into a SparseGraph
+class SparseGraphBuilder {
+  private:
+    std::vector<size_t> sources;
+    std::vector<size_t> targets;
+
+  public:
+    void reserve(size_t edges) {
+        sources.reserve(edges);
+        targets.reserve(edges);
+    }
+
+    void add_edge(size_t from, size_t to) {
+        sources.push_back(from);
+        targets.push_back(to);
+    }
+
+    void add_undirected_edge(size_t a, size_t b) {
+        add_edge(a, b);
+        add_edge(b, a);
+    }
+
+    size_t edge_count() const { return sources.size(); }
+
+    // Builds the CSR arrays using `threads` threads (0 = one per hardware thread). Vertex keys are
+    // radix sorted to assign dense ids, then edges are radix sorted by source id; the sort is
+    // stable, so each vertex's neighbours keep the order their edges were added in.
+    SparseGraph build(unsigned threads = 0) const {
+        size_t edges = sources.size();
+        if (edges > std::numeric_limits<uint32_t>::max() / 2) {
+            throw std::length_error("SparseGraphBuilder::build: too many edges");
+        }
+        SparseGraph graph;
+        threads = sparse_parallel::resolve_threads(threads, edges);
+
+        // Dense vertex ids in key order
+        std::vector<sparse_parallel::KeyIndex> keys(edges * 2);
+        sparse_parallel::parallel_for(edges, threads, [&](size_t begin, size_t end, unsigned) {
+            for (size_t i = begin; i < end; ++i) {
+                keys[2 * i] = {sources[i], 0};
+                keys[2 * i + 1] = {targets[i], 0};
+            }
+        });
+        sparse_parallel::radix_sort(keys, threads);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (i == 0 || keys[i].key != keys[i - 1].key) {
+                graph.vertex_keys.push_back(keys[i].key);
+            }
+        }
+        std::vector<SparseGraph::vertex_id> ids(graph.vertex_keys.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            ids[i] = static_cast<SparseGraph::vertex_id>(i);
+        }
+        graph.vertex_ids = SparseVector<SparseGraph::vertex_id>(graph.vertex_keys, std::move(ids));
+        // Workers read ids through the const operator[], which never inserts or modifies the index
+        const SparseVector<SparseGraph::vertex_id>& id_of_key = graph.vertex_ids;
+
+        // Edges grouped by source id
+        std::vector<sparse_parallel::KeyIndex> by_source(edges);
+        sparse_parallel::parallel_for(edges, threads, [&](size_t begin, size_t end, unsigned) {
+            for (size_t i = begin; i < end; ++i) {
+                by_source[i] = {id_of_key[sources[i]], static_cast<uint32_t>(i)};
+            }
+        });
+        sparse_parallel::radix_sort(by_source, threads);
+
+        graph.offsets.assign(graph.vertex_keys.size() + 1, 0);
+        for (const auto& edge : by_source) {
+            ++graph.offsets[edge.key + 1];
+        }
+        for (size_t v = 0; v < graph.vertex_keys.size(); ++v) {
+            graph.offsets[v + 1] += graph.offsets[v];
+        }
+        graph.neighbours.resize(edges);
+        sparse_parallel::parallel_for(edges, threads, [&](size_t begin, size_t end, unsigned) {
+            for (size_t i = begin; i < end; ++i) {
+                graph.neighbours[i] = id_of_key[targets[by_source[i].index]];
+            }
+        });
+        return graph;
+    }
+};
+
+#endif //SPARSEGRAPH_HPP_
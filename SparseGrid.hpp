@@ -0,0 +1,331 @@
+#ifndef SPARSEGRID_HPP_
+#define SPARSEGRID_HPP_
+
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "SparseVector.hpp"
+#include "SparseVectorView.hpp"
+
+// Morton (Z-order) encoding: interleaves the bits of Dims coordinates into one key, so cells that
+// are close in space get close keys
+namespace sparse_morton {
+
+template<size_t Dims>
+constexpr unsigned bits_per_axis = static_cast<unsigned>(64 / Dims);
+
+// Spreads the low 32 bits of x so there is one zero bit between each
+inline uint64_t spread_by_1(uint64_t x) {
+    x &= 0xffffffff;
+    x = (x | (x << 16)) & 0x0000ffff0000ffff;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0f;
+    x = (x | (x << 2)) & 0x3333333333333333;
+    x = (x | (x << 1)) & 0x5555555555555555;
+    return x;
+}
+
+inline uint64_t compact_by_1(uint64_t x) {
+    x &= 0x5555555555555555;
+    x = (x | (x >> 1)) & 0x3333333333333333;
+    x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0f;
+    x = (x | (x >> 4)) & 0x00ff00ff00ff00ff;
+    x = (x | (x >> 8)) & 0x0000ffff0000ffff;
+    x = (x | (x >> 16)) & 0x00000000ffffffff;
+    return x;
+}
+
+// Spreads the low 21 bits of x so there are two zero bits between each
+inline uint64_t spread_by_2(uint64_t x) {
+    x &= 0x1fffff;
+    x = (x | (x << 32)) & 0x001f00000000ffff;
+    x = (x | (x << 16)) & 0x001f0000ff0000ff;
+    x = (x | (x << 8)) & 0x100f00f00f00f00f;
+    x = (x | (x << 4)) & 0x10c30c30c30c30c3;
+    x = (x | (x << 2)) & 0x1249249249249249;
+    return x;
+}
+
+inline uint64_t compact_by_2(uint64_t x) {
+    x &= 0x1249249249249249;
+    x = (x | (x >> 2)) & 0x10c30c30c30c30c3;
+    x = (x | (x >> 4)) & 0x100f00f00f00f00f;
+    x = (x | (x >> 8)) & 0x001f0000ff0000ff;
+    x = (x | (x >> 16)) & 0x001f00000000ffff;
+    x = (x | (x >> 32)) & 0x00000000001fffff;
+    return x;
+}
+
+template<size_t Dims>
+uint64_t encode(const std::array<uint32_t, Dims>& coord) {
+    if constexpr (Dims == 1) {
+        return coord[0];
+    } else if constexpr (Dims == 2) {
+        return spread_by_1(coord[0]) | (spread_by_1(coord[1]) << 1);
+    } else if constexpr (Dims == 3) {
+        return spread_by_2(coord[0]) | (spread_by_2(coord[1]) << 1) | (spread_by_2(coord[2]) << 2);
+    } else {
+        uint64_t key = 0;
+        for (unsigned bit = 0; bit < bits_per_axis<Dims>; ++bit) {
+            for (size_t axis = 0; axis < Dims; ++axis) {
+                key |= static_cast<uint64_t>((coord[axis] >> bit) & 1) << (bit * Dims + axis);
+            }
+        }
+        return key;
+    }
+}
+
+template<size_t Dims>
+std::array<uint32_t, Dims> decode(uint64_t key) {
+    std::array<uint32_t, Dims> coord{};
+    if constexpr (Dims == 1) {
+        coord[0] = static_cast<uint32_t>(key);
+    } else if constexpr (Dims == 2) {
+        coord[0] = static_cast<uint32_t>(compact_by_1(key));
+        coord[1] = static_cast<uint32_t>(compact_by_1(key >> 1));
+    } else if constexpr (Dims == 3) {
+        coord[0] = static_cast<uint32_t>(compact_by_2(key));
+        coord[1] = static_cast<uint32_t>(compact_by_2(key >> 1));
+        coord[2] = static_cast<uint32_t>(compact_by_2(key >> 2));
+    } else {
+        for (unsigned bit = 0; bit < bits_per_axis<Dims>; ++bit) {
+            for (size_t axis = 0; axis < Dims; ++axis) {
+                coord[axis] |= static_cast<uint32_t>((key >> (bit * Dims + axis)) & 1) << bit;
+            }
+        }
+    }
+    return coord;
+}
+
+}  // namespace sparse_morton
+
+// SparseVector over Dims-dimensional cell coordinates. Coordinates are linearised with Morton
+// encoding, so spatially close cells are close in the index and in iteration order, and box or
+// neighbourhood queries visit the index as a few contiguous key ranges.
+//
+// Keys index the dense SparseVector index, so the key span is what costs memory. By default
+// every axis gets bits_per_axis bits, which suits cubic domains. For other shapes pass the
+// largest coordinate of each axis: an axis then only takes the bits its range needs, interleaved
+// with the others from the lowest bit up, so e.g. a 1024 x 16 x 16 domain spans 2^18 keys rather
+// than 2^30. The default layout is plain Morton order.
+template<typename T, size_t Dims>
+class SparseGrid {
+    static_assert(Dims >= 1 && Dims <= 16, "SparseGrid supports 1 to 16 dimensions");
+
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using coord_type = std::array<uint32_t, Dims>;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+
+    static constexpr unsigned bits_per_axis = std::min(32u, sparse_morton::bits_per_axis<Dims>);
+    static constexpr uint32_t max_coordinate = static_cast<uint32_t>((uint64_t{1} << bits_per_axis) - 1);
+
+  private:
+    SparseVector<T> cells;
+    coord_type limits;                     // largest coordinate per axis
+    std::array<uint64_t, Dims> axis_mask;  // key bits holding each axis, lowest first
+    bool cubic = true;                     // every axis has bits_per_axis bits: use the fast encoding
+
+    static unsigned bit_width(uint32_t x) {
+        unsigned bits = 0;
+        for (; x != 0; x >>= 1) {
+            ++bits;
+        }
+        return bits;
+    }
+
+    void assign_bits(const coord_type& largest) {
+        std::array<unsigned, Dims> bits;
+        unsigned total = 0;
+        unsigned widest = 0;
+        for (size_t axis = 0; axis < Dims; ++axis) {
+            bits[axis] = bit_width(largest[axis]);
+            total += bits[axis];
+            widest = std::max(widest, bits[axis]);
+            cubic &= bits[axis] == bits_per_axis;
+        }
+        if (total > 64) {
+            throw std::length_error("SparseGrid: the coordinate ranges need " + std::to_string(total)
+                                    + " key bits, more than 64");
+        }
+        limits = largest;
+        axis_mask.fill(0);
+        unsigned position = 0;
+        for (unsigned bit = 0; bit < widest; ++bit) {
+            for (size_t axis = 0; axis < Dims; ++axis) {
+                if (bit < bits[axis]) {
+                    axis_mask[axis] |= uint64_t{1} << position++;
+                }
+            }
+        }
+    }
+
+    void check_coord(const coord_type& coord) const {
+        for (size_t axis = 0; axis < Dims; ++axis) {
+            if (coord[axis] > limits[axis]) {
+                throw std::out_of_range("SparseGrid: coordinate " + std::to_string(coord[axis]) + " on axis "
+                                        + std::to_string(axis) + " exceeds " + std::to_string(limits[axis]));
+            }
+        }
+    }
+
+    // Coordinate range [lo, lo + 2^bits) of each axis within the keys [base, base + 2^low_bits)
+    void key_range_box(uint64_t base, unsigned low_bits, coord_type& lo, std::array<unsigned, Dims>& bits) const {
+        uint64_t low_mask = low_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << low_bits) - 1;
+        lo = coord_of(base);
+        for (size_t axis = 0; axis < Dims; ++axis) {
+            bits[axis] = static_cast<unsigned>(sparse_bits::popcount(axis_mask[axis] & low_mask));
+        }
+    }
+
+    // Visits the keys [base, base + 2^low_bits), keeping only cells in [lo, hi]. Ranges wholly
+    // inside the box are read contiguously; straddling ones are split on their top key bit.
+    template<typename F>
+    void visit_range(const SparseVectorView<const T>& view, uint64_t base, unsigned low_bits,
+                     const coord_type& lo, const coord_type& hi, F& f) const {
+        if (base >= view.last_index()) {
+            return;
+        }
+        coord_type range_lo;
+        std::array<unsigned, Dims> bits;
+        key_range_box(base, low_bits, range_lo, bits);
+        bool inside = true;
+        for (size_t axis = 0; axis < Dims; ++axis) {
+            uint64_t range_hi = range_lo[axis] + (uint64_t{1} << bits[axis]) - 1;
+            if (range_lo[axis] > hi[axis] || range_hi < lo[axis]) {
+                return;
+            }
+            inside &= range_lo[axis] >= lo[axis] && range_hi <= hi[axis];
+        }
+        if (inside) {
+            uint64_t last = low_bits >= 64 ? std::numeric_limits<uint64_t>::max() : base + (uint64_t{1} << low_bits);
+            auto range = view.subview(base, last);
+            for (auto it = range.begin(); it != range.end(); ++it) {
+                f(coord_of(it.index()), *it);
+            }
+            return;
+        }
+        visit_range(view, base, low_bits - 1, lo, hi, f);
+        visit_range(view, base + (uint64_t{1} << (low_bits - 1)), low_bits - 1, lo, hi, f);
+    }
+
+  public:
+    // Constructors
+    SparseGrid() {
+        coord_type largest;
+        largest.fill(max_coordinate);
+        assign_bits(largest);
+    }
+
+    // Grid whose coordinates on each axis run from 0 to largest[axis]
+    explicit SparseGrid(const coord_type& largest) {
+        assign_bits(largest);
+    }
+
+    // Largest coordinate accepted on each axis
+    const coord_type& max_coordinates() const { return limits; }
+
+    // Morton key of a cell, i.e. its index in storage()
+    uint64_t key_of(const coord_type& coord) const {
+        check_coord(coord);
+        if (cubic) {
+            return sparse_morton::encode<Dims>(coord);
+        }
+        uint64_t key = 0;
+        for (size_t axis = 0; axis < Dims; ++axis) {
+            uint32_t value = coord[axis];
+            for (uint64_t mask = axis_mask[axis]; mask != 0 && value != 0; mask &= mask - 1, value >>= 1) {
+                key |= (value & 1) ? mask & (~mask + 1) : 0;
+            }
+        }
+        return key;
+    }
+
+    coord_type coord_of(uint64_t key) const {
+        if (cubic) {
+            return sparse_morton::decode<Dims>(key);
+        }
+        coord_type coord{};
+        for (size_t axis = 0; axis < Dims; ++axis) {
+            unsigned bit = 0;
+            for (uint64_t mask = axis_mask[axis]; mask != 0; mask &= mask - 1, ++bit) {
+                coord[axis] |= static_cast<uint32_t>((key & mask & (~mask + 1)) != 0) << bit;
+            }
+        }
+        return coord;
+    }
+
+    // Element access
+    T& operator[](const coord_type& coord) { return cells[key_of(coord)]; }
+    const T& operator[](const coord_type& coord) const { return cells[key_of(coord)]; }
+    T& at(const coord_type& coord) { return cells.at(key_of(coord)); }
+    const T& at(const coord_type& coord) const { return cells.at(key_of(coord)); }
+
+    // The underlying Morton ordered container
+    const SparseVector<T>& storage() const { return cells; }
+
+    // Capacity
+    bool empty() const { return cells.empty(); }
+    size_type size() const { return cells.size(); }
+
+    // Modifiers
+    void clear() { cells.clear(); }
+    void insert(const coord_type& coord, const T& value) { cells.insert(key_of(coord), value); }
+    void erase(const coord_type& coord) { cells.erase(key_of(coord)); }
+
+    // Lookup
+    bool contains(const coord_type& coord) const { return cells.contains(key_of(coord)); }
+
+    // Calls f(coord, value) for every cell, in Morton order
+    template<typename F>
+    void for_each(F f) const {
+        for (auto it = cells.begin(); it != cells.end(); ++it) {
+            f(coord_of(it.index()), *it);
+        }
+    }
+
+    // Calls f(coord, value) for every cell in the box [lo, hi] (inclusive), in Morton order
+    template<typename F>
+    void for_each_in_box(const coord_type& lo, const coord_type& hi, F f) const {
+        check_coord(lo);
+        check_coord(hi);
+        for (size_t axis = 0; axis < Dims; ++axis) {
+            if (lo[axis] > hi[axis]) {
+                return;
+            }
+        }
+        unsigned key_bits = 0;
+        for (size_t axis = 0; axis < Dims; ++axis) {
+            key_bits += static_cast<unsigned>(sparse_bits::popcount(axis_mask[axis]));
+        }
+        SparseVectorView<const T> view(cells);
+        visit_range(view, 0, key_bits, lo, hi, f);
+    }
+
+    // Calls f(coord, value) for every cell within Chebyshev distance radius of center, including
+    // center itself
+    template<typename F>
+    void for_each_neighbor(const coord_type& center, uint32_t radius, F f) const {
+        check_coord(center);
+        coord_type lo;
+        coord_type hi;
+        for (size_t axis = 0; axis < Dims; ++axis) {
+            lo[axis] = center[axis] > radius ? center[axis] - radius : 0;
+            hi[axis] = static_cast<uint32_t>(std::min<uint64_t>(uint64_t{center[axis]} + radius, limits[axis]));
+        }
+        for_each_in_box(lo, hi, f);
+    }
+
+    // Memory usage calculation
+    std::pair<size_t, size_t> memory_usage() const {
+        return cells.memory_usage();
+    }
+};
+
+#endif //SPARSEGRID_HPP_
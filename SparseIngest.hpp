@@ -0,0 +1,213 @@
+#ifndef SPARSEINGEST_HPP_
+#define SPARSEINGEST_HPP_
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include "SparseVector.hpp"
+
+// Lock-free bounded ring buffers carrying updates from producer threads to the thread that owns a
+// SparseVector, and a pipeline that drains them in batches
+namespace sparse_ingest {
+
+// Keeps the producer and consumer positions on separate cache lines
+constexpr size_t cache_line = 64;
+
+inline size_t round_up_pow2(size_t n) {
+    size_t capacity = 2;
+    while (capacity < n) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+// Single producer, single consumer ring. Each side caches the other side's position and only
+// reloads it when the ring looks full (producer) or empty (consumer).
+template<typename T>
+class SpscRing {
+  private:
+    std::vector<T> slots;
+    size_t mask;
+    alignas(cache_line) std::atomic<size_t> head{0};
+    size_t cached_tail = 0;
+    alignas(cache_line) std::atomic<size_t> tail{0};
+    size_t cached_head = 0;
+
+  public:
+    // Capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) : slots(round_up_pow2(capacity)), mask(slots.size() - 1) {}
+
+    size_t capacity() const { return slots.size(); }
+
+    // Producer side; value is only moved from when the push succeeds
+    bool try_push(T&& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head == slots.size()) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head == slots.size()) {
+                return false;
+            }
+        }
+        slots[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: passes up to max queued values to out(T&&), oldest first
+    template<typename Out>
+    size_t pop_batch(Out&& out, size_t max) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (cached_tail == h) {
+            cached_tail = tail.load(std::memory_order_acquire);
+        }
+        size_t n = std::min(cached_tail - h, max);
+        for (size_t i = 0; i < n; ++i) {
+            out(std::move(slots[(h + i) & mask]));
+        }
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+};
+
+// Multiple producer, single consumer ring. Every cell carries a sequence number that says whether
+// it is free for the producer claiming position pos (sequence == pos) or holds the value written
+// at pos (sequence == pos + 1); producers claim positions with a compare-exchange on tail.
+template<typename T>
+class MpscRing {
+  private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(cache_line) std::atomic<size_t> tail{0};
+    alignas(cache_line) size_t head = 0;
+
+  public:
+    explicit MpscRing(size_t capacity) : cells(new Cell[round_up_pow2(capacity)]), mask(round_up_pow2(capacity) - 1) {
+        for (size_t i = 0; i <= mask; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    // Producer side, safe from any number of threads; value is only moved from when the push succeeds
+    bool try_push(T&& value) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: passes up to max published values to out(T&&), in claim order
+    template<typename Out>
+    size_t pop_batch(Out&& out, size_t max) {
+        size_t n = 0;
+        while (n < max) {
+            Cell& cell = cells[head & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != head + 1) {
+                break;
+            }
+            out(std::move(cell.value));
+            cell.sequence.store(head + mask + 1, std::memory_order_release);
+            ++head;
+            ++n;
+        }
+        return n;
+    }
+};
+
+template<typename T>
+using UpdateRecord = typename SparseVector<T>::Update;
+
+}  // namespace sparse_ingest
+
+// Producers submit updates through a bounded lock-free ring; the thread owning the target
+// SparseVector calls drain() to apply them. Each drained batch goes through
+// SparseVector::apply_batch(), which prefetches ahead through the batch and compacts erased
+// objects once per batch. Use SpscRing for a single producer.
+template<typename T, typename Ring = sparse_ingest::MpscRing<sparse_ingest::UpdateRecord<T>>>
+class IngestionPipeline {
+  public:
+    using record_type = sparse_ingest::UpdateRecord<T>;
+
+  private:
+    Ring ring;
+    std::vector<record_type> batch;
+
+  public:
+    explicit IngestionPipeline(size_t capacity = size_t{1} << 16) : ring(capacity) {}
+
+    size_t capacity() const { return ring.capacity(); }
+
+    // Producer side: false when the ring is full
+    bool try_submit(record_type record) {
+        return ring.try_push(std::move(record));
+    }
+
+    bool try_submit(size_t key, T value) {
+        return try_submit(record_type{key, std::move(value)});
+    }
+
+    // Producer side: yields until there is room
+    void submit(record_type record) {
+        while (!ring.try_push(std::move(record))) {
+            std::this_thread::yield();
+        }
+    }
+
+    void submit(size_t key, T value) {
+        submit(record_type{key, std::move(value)});
+    }
+
+    void submit_erase(size_t key) {
+        submit(record_type{key, T{}, SparseVector<T>::BatchOp::Erase});
+    }
+
+    // Consumer side: applies up to max_batch queued updates to target and returns how many.
+    // max_batch = 0 means one ring's worth, which bounds the call even while producers keep the
+    // ring full. combine merges Combine updates into existing values.
+    // apply_batch() rejects a batch (too large, allocation failure, a Combine update combine cannot
+    // merge) before applying any of it, so when it throws the popped records are kept and the
+    // next drain() retries them, with a fixed combine if need be, before popping more.
+    template<typename Combine = std::plus<>>
+    size_t drain(SparseVector<T>& target, size_t max_batch = 0, Combine combine = Combine()) {
+        if (max_batch == 0) {
+            max_batch = ring.capacity();
+        }
+        if (batch.empty()) {
+            ring.pop_batch([&](record_type&& record) { batch.push_back(std::move(record)); }, max_batch);
+        }
+        size_t applied = batch.size();
+        target.apply_batch(std::move(batch), combine);
+        batch.clear();
+        return applied;
+    }
+
+    // Records kept by a drain() whose apply_batch() threw, waiting to be retried
+    size_t pending() const { return batch.size(); }
+};
+
+#endif //SPARSEINGEST_HPP_
@@ -0,0 +1,201 @@
+#ifndef SPARSEPARALLEL_HPP_
+#define SPARSEPARALLEL_HPP_
+
+#include <vector>
+#include <thread>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+// Threading helpers shared by the parallel bulk operations
+namespace sparse_parallel {
+
+// Work below this many elements is not worth starting threads for
+constexpr size_t min_parallel_size = size_t{1} << 14;
+
+// Work below this many bytes of heavy elements is not worth starting threads for either
+constexpr size_t min_parallel_bytes = size_t{1} << 20;
+
+// Turns a requested thread count (0 = one per hardware thread) into the number to use for n items,
+// staying single threaded below min_size items
+inline unsigned resolve_threads(unsigned requested, size_t n, size_t min_size = min_parallel_size) {
+    unsigned threads = requested != 0 ? requested : std::max(1u, std::thread::hardware_concurrency());
+    if (n < std::max<size_t>(min_size, 2)) {
+        return 1;
+    }
+    return static_cast<unsigned>(std::min<size_t>(threads, n));
+}
+
+// Splits [0, n) into `threads` contiguous chunks and calls f(begin, end, chunk) for each, one chunk
+// per thread. The split only depends on n and threads, so successive calls see the same chunks.
+// The first exception thrown by any chunk is rethrown once every thread has finished.
+template<typename F>
+void parallel_for(size_t n, unsigned threads, F&& f) {
+    if (threads <= 1) {
+        f(size_t{0}, n, 0u);
+        return;
+    }
+    size_t chunk = (n + threads - 1) / threads;
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    auto run = [&](unsigned t) {
+        try {
+            size_t begin = std::min(n, t * chunk);
+            size_t end = std::min(n, begin + chunk);
+            f(begin, end, t);
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back(run, t);
+    }
+    run(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+struct KeyIndex {
+    uint64_t key;
+    uint32_t index;
+};
+
+// Stable LSD radix sort of (key, index) pairs by key, one byte per pass. Each pass builds per
+// thread digit histograms, turns them into per thread output offsets and scatters in parallel.
+inline void radix_sort(std::vector<KeyIndex>& items, unsigned threads) {
+    size_t n = items.size();
+    if (n < 2) {
+        return;
+    }
+    uint64_t max_key = 0;
+    for (const KeyIndex& item : items) {
+        max_key = std::max(max_key, item.key);
+    }
+
+    std::vector<KeyIndex> buffer(n);
+    std::vector<size_t> offsets(size_t{threads} * 256);
+    for (unsigned shift = 0; shift < 64 && (max_key >> shift) != 0; shift += 8) {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        parallel_for(n, threads, [&](size_t begin, size_t end, unsigned t) {
+            size_t* counts = offsets.data() + size_t{t} * 256;
+            for (size_t i = begin; i < end; ++i) {
+                ++counts[(items[i].key >> shift) & 0xff];
+            }
+        });
+
+        size_t running = 0;
+        for (size_t digit = 0; digit < 256; ++digit) {
+            for (unsigned t = 0; t < threads; ++t) {
+                size_t count = offsets[size_t{t} * 256 + digit];
+                offsets[size_t{t} * 256 + digit] = running;
+                running += count;
+            }
+        }
+
+        parallel_for(n, threads, [&](size_t begin, size_t end, unsigned t) {
+            size_t* next = offsets.data() + size_t{t} * 256;
+            for (size_t i = begin; i < end; ++i) {
+                buffer[next[(items[i].key >> shift) & 0xff]++] = items[i];
+            }
+        });
+        items.swap(buffer);
+    }
+}
+
+// Fixed set of worker threads running queued jobs in FIFO order. Used by the *_async operations so
+// callers (e.g. event loop threads) can hand off bulk work and collect it through a std::future.
+// The destructor finishes every queued job before joining the workers.
+class ThreadPool {
+  private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+
+    void work() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [&] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+  public:
+    // threads = 0 starts one worker per hardware thread
+    explicit ThreadPool(unsigned threads = 0) {
+        threads = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        workers.reserve(threads);
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // Queues a job whose exceptions are the job's own business
+    void post(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        ready.notify_one();
+    }
+
+    // Queues f() and returns a future for its result; exceptions thrown by f are stored in the future
+    template<typename F>
+    std::future<std::invoke_result_t<std::decay_t<F>&>> submit(F&& f) {
+        using Result = std::invoke_result_t<std::decay_t<F>&>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+        std::future<Result> result = task->get_future();
+        post([task] { (*task)(); });
+        return result;
+    }
+};
+
+// Pool used by the *_async operations when none is given, started on first use
+inline ThreadPool& default_pool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+}  // namespace sparse_parallel
+
+#endif //SPARSEPARALLEL_HPP_
@@ -0,0 +1,247 @@
+#ifndef SPARSERUNVECTOR_HPP_
+#define SPARSERUNVECTOR_HPP_
+
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <cstdint>
+
+// Run-length encoded SparseVector for data where long ranges of consecutive indices share a
+// value. Storage is a sorted vector of non-overlapping (start, length, value) runs, lookups are
+// a binary search over run starts, and adjacent runs with equal values are always merged.
+// Elements are read-only; updates go through insert()/assign() so runs can be split and merged.
+template<typename T>
+class SparseRunVector {
+  public:
+    struct Run {
+        size_t start;
+        size_t length;
+        T value;
+
+        size_t end() const { return start + length; }
+    };
+
+  private:
+    std::vector<Run> run_list;
+    size_t count = 0;
+
+    // Index of the first run starting after pos
+    size_t upper_run(size_t pos) const {
+        return std::upper_bound(run_list.begin(), run_list.end(), pos,
+                                [](size_t p, const Run& run) { return p < run.start; }) - run_list.begin();
+    }
+
+    // Index of the run covering pos, or run_list.size() if pos is not set
+    size_t find_run(size_t pos) const {
+        size_t i = upper_run(pos);
+        if (i > 0 && pos < run_list[i - 1].end()) {
+            return i - 1;
+        }
+        return run_list.size();
+    }
+
+    // Merges run i with equal-valued neighbours that touch it
+    void merge_around(size_t i) {
+        if (i + 1 < run_list.size() && run_list[i].end() == run_list[i + 1].start
+            && run_list[i].value == run_list[i + 1].value) {
+            run_list[i].length += run_list[i + 1].length;
+            run_list.erase(run_list.begin() + i + 1);
+        }
+        if (i > 0 && run_list[i - 1].end() == run_list[i].start && run_list[i - 1].value == run_list[i].value) {
+            run_list[i - 1].length += run_list[i].length;
+            run_list.erase(run_list.begin() + i);
+        }
+    }
+
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using const_reference = const value_type&;
+    using const_pointer = const value_type*;
+
+    // Visits every set index in order, expanding runs
+    class Iterator {
+      private:
+        const SparseRunVector* container;
+        size_t run;
+        size_t current_index;
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = const T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = value_type*;
+        using reference = value_type&;
+
+        Iterator(const SparseRunVector* cont, size_t run_index, size_t index)
+            : container(cont), run(run_index), current_index(index) {}
+
+        reference operator*() const {
+            return container->run_list[run].value;
+        }
+
+        pointer operator->() const {
+            return &(operator*());
+        }
+
+        // Sparse index of the current element
+        size_type index() const {
+            return current_index;
+        }
+
+        Iterator& operator++() {
+            if (++current_index >= container->run_list[run].end()) {
+                ++run;
+                current_index = run < container->run_list.size() ? container->run_list[run].start : 0;
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return container == other.container && run == other.run && current_index == other.current_index;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    const_iterator begin() const {
+        return run_list.empty() ? end() : const_iterator(this, 0, run_list.front().start);
+    }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator end() const { return const_iterator(this, run_list.size(), 0); }
+    const_iterator cend() const { return end(); }
+
+    // The runs themselves, for traversal that scales with the number of runs
+    const std::vector<Run>& runs() const { return run_list; }
+
+    // Constructors
+    SparseRunVector() = default;
+
+    // Element access
+    const T& at(size_type pos) const {
+        size_t i = find_run(pos);
+        if (i == run_list.size()) {
+            throw std::out_of_range("SparseRunVector::at: pos (which is "
+                                    + std::to_string(pos) + ") is not set");
+        }
+        return run_list[i].value;
+    }
+
+    const T& operator[](size_type pos) const {
+        return at(pos);
+    }
+
+    // Capacity
+    bool empty() const { return count == 0; }
+    size_type size() const { return count; }
+    size_type run_count() const { return run_list.size(); }
+    size_type max_size() const { return run_list.max_size(); }
+
+    void shrink_to_fit() {
+        run_list.shrink_to_fit();
+    }
+
+    // Modifiers
+    void clear() {
+        run_list.clear();
+        count = 0;
+    }
+
+    void insert(size_type pos, const T& value) {
+        assign(pos, pos + 1, value);
+    }
+
+    // Sets every index in [first, last) to value
+    void assign(size_type first, size_type last, const T& value) {
+        if (first >= last) {
+            return;
+        }
+        size_t covering = find_run(first);
+        if (covering != run_list.size() && last <= run_list[covering].end() && run_list[covering].value == value) {
+            return;
+        }
+        erase(first, last);
+        size_t i = upper_run(first);
+        run_list.insert(run_list.begin() + i, Run{first, last - first, value});
+        count += last - first;
+        merge_around(i);
+    }
+
+    void erase(size_type pos) {
+        erase(pos, pos + 1);
+    }
+
+    // Removes every index in [first, last), splitting runs that straddle the bounds
+    void erase(size_type first, size_type last) {
+        if (first >= last) {
+            return;
+        }
+        size_t i = upper_run(first);
+        if (i > 0 && run_list[i - 1].end() > first) {
+            --i;
+        }
+        size_t remove_from = run_list.size();
+        size_t remove_to = run_list.size();
+        for (; i < run_list.size() && run_list[i].start < last; ++i) {
+            Run& run = run_list[i];
+            size_t run_end = run.end();
+            count -= std::min(run_end, last) - std::max(run.start, first);
+            if (run.start < first && run_end > last) {
+                Run right{last, run_end - last, run.value};
+                run.length = first - run.start;
+                run_list.insert(run_list.begin() + i + 1, std::move(right));
+                return;
+            }
+            if (run.start < first) {
+                run.length = first - run.start;
+            } else if (run_end > last) {
+                run.start = last;
+                run.length = run_end - last;
+            } else {
+                if (remove_from == run_list.size()) {
+                    remove_from = i;
+                }
+                remove_to = i + 1;
+            }
+        }
+        if (remove_from != run_list.size()) {
+            run_list.erase(run_list.begin() + remove_from, run_list.begin() + remove_to);
+        }
+    }
+
+    void swap(SparseRunVector& other) {
+        run_list.swap(other.run_list);
+        std::swap(count, other.count);
+    }
+
+    // Lookup
+    bool contains(size_type pos) const {
+        return find_run(pos) != run_list.size();
+    }
+
+    const_iterator find(size_type pos) const {
+        size_t i = find_run(pos);
+        return i == run_list.size() ? end() : const_iterator(this, i, pos);
+    }
+
+    // Memory usage calculation
+    size_t memory_usage() const {
+        return run_list.capacity() * sizeof(Run);
+    }
+};
+
+#endif //SPARSERUNVECTOR_HPP_
@@ -0,0 +1,375 @@
+#ifndef SPARSESET_HPP_
+#define SPARSESET_HPP_
+
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <atomic>
+#include <mutex>
+
+// Bit twiddling helpers shared by the bitmap based containers
+namespace sparse_bits {
+
+inline size_t popcount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_popcountll(word));
+#else
+    size_t count = 0;
+    for (; word; word &= word - 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// Index of the lowest set bit; word must be non-zero
+inline size_t countr_zero(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_ctzll(word));
+#else
+    size_t count = 0;
+    for (; !(word & 1); word >>= 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// Rank/select support over a bitmap: blocks[b] holds the number of set bits in the words before
+// block b, one block being rank_block_words words
+constexpr size_t rank_block_words = 8;
+
+inline void build_rank_blocks(const std::vector<uint64_t>& words, std::vector<size_t>& blocks) {
+    size_t block_count = (words.size() + rank_block_words - 1) / rank_block_words;
+    blocks.assign(block_count + 1, 0);
+    size_t total = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (i % rank_block_words == 0) {
+            blocks[i / rank_block_words] = total;
+        }
+        total += popcount(words[i]);
+    }
+    blocks.back() = total;
+}
+
+// Number of set bits below position pos
+inline size_t rank(const std::vector<uint64_t>& words, const std::vector<size_t>& blocks, size_t pos) {
+    size_t word_index = pos / 64;
+    if (word_index >= words.size()) {
+        return blocks.back();
+    }
+    size_t count = blocks[word_index / rank_block_words];
+    for (size_t i = word_index - word_index % rank_block_words; i < word_index; ++i) {
+        count += popcount(words[i]);
+    }
+    return count + popcount(words[word_index] & ((uint64_t{1} << (pos % 64)) - 1));
+}
+
+// Position of the set bit with rank n; n must be below the total number of set bits
+inline size_t select(const std::vector<uint64_t>& words, const std::vector<size_t>& blocks, size_t n) {
+    size_t block = std::upper_bound(blocks.begin(), blocks.end() - 1, n) - blocks.begin() - 1;
+    size_t remaining = n - blocks[block];
+    size_t word_index = block * rank_block_words;
+    for (;; ++word_index) {
+        size_t ones = popcount(words[word_index]);
+        if (remaining < ones) {
+            break;
+        }
+        remaining -= ones;
+    }
+    uint64_t word = words[word_index];
+    for (; remaining > 0; --remaining) {
+        word &= word - 1;
+    }
+    return word_index * 64 + countr_zero(word);
+}
+
+// Lazily built rank/select index over a bitmap. Modifications call invalidate(); the next
+// rank()/select() rebuilds under a mutex, so any number of threads may query a const container
+// at once. Copies and moves start unbuilt (a moved-from source included), since the bitmap they
+// describe is not carried along.
+class RankCache {
+  private:
+    mutable std::mutex mutex;
+    mutable std::atomic<bool> valid{false};
+    mutable std::vector<uint64_t> bitmap;
+    mutable std::vector<size_t> block_ranks;
+
+  public:
+    RankCache() = default;
+    RankCache(const RankCache&) {}
+    RankCache(RankCache&& other) noexcept { other.invalidate(); }
+
+    RankCache& operator=(const RankCache&) {
+        invalidate();
+        return *this;
+    }
+
+    RankCache& operator=(RankCache&& other) noexcept {
+        invalidate();
+        other.invalidate();
+        return *this;
+    }
+
+    void invalidate() { valid.store(false, std::memory_order_relaxed); }
+
+    // Runs build(bitmap, block_ranks) unless the index is current
+    template<typename Build>
+    void ensure(Build&& build) const {
+        if (valid.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!valid.load(std::memory_order_relaxed)) {
+            build(bitmap, block_ranks);
+            valid.store(true, std::memory_order_release);
+        }
+    }
+
+    const std::vector<uint64_t>& words() const { return bitmap; }
+    const std::vector<size_t>& blocks() const { return block_ranks; }
+
+    size_t memory_usage() const {
+        return bitmap.capacity() * sizeof(uint64_t) + block_ranks.capacity() * sizeof(size_t);
+    }
+};
+
+}  // namespace sparse_bits
+
+// Membership-only counterpart of SparseVector<bool>: one bit per possible key
+class SparseSet {
+  private:
+    static constexpr size_t bits_per_word = 64;
+
+    std::vector<uint64_t> words;
+    sparse_bits::RankCache rank_cache;  // only its blocks are used; the bitmap is words
+
+    // Drops trailing empty words so that equal sets have equal storage
+    void trim() {
+        rank_cache.invalidate();
+        while (!words.empty() && words.back() == 0) {
+            words.pop_back();
+        }
+    }
+
+  public:
+    using value_type = std::size_t;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    class Iterator {
+      private:
+        const SparseSet* container;
+        size_t current_index;
+
+        void advance_to_valid() {
+            size_t word_index = current_index / bits_per_word;
+            if (word_index >= container->words.size()) {
+                current_index = container->end_index();
+                return;
+            }
+            uint64_t word = container->words[word_index] & (~uint64_t{0} << (current_index % bits_per_word));
+            while (word == 0) {
+                if (++word_index >= container->words.size()) {
+                    current_index = container->end_index();
+                    return;
+                }
+                word = container->words[word_index];
+            }
+            current_index = word_index * bits_per_word + sparse_bits::countr_zero(word);
+        }
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::size_t*;
+        using reference = const std::size_t&;
+
+        Iterator(const SparseSet* cont, size_t index) : container(cont), current_index(index) {
+            advance_to_valid();
+        }
+
+        reference operator*() const {
+            return current_index;
+        }
+
+        Iterator& operator++() {
+            ++current_index;
+            advance_to_valid();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return container == other.container && current_index == other.current_index;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator cbegin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, end_index()); }
+    const_iterator cend() const { return const_iterator(this, end_index()); }
+
+    // Constructors
+    SparseSet() = default;
+    SparseSet(std::initializer_list<size_type> keys) {
+        for (size_type key : keys) {
+            insert(key);
+        }
+    }
+
+    // Capacity
+    bool empty() const { return words.empty(); }
+    size_type size() const {
+        size_type count = 0;
+        for (uint64_t word : words) {
+            count += sparse_bits::popcount(word);
+        }
+        return count;
+    }
+    size_type max_size() const { return words.max_size(); }
+    size_t capacity() const { return words.capacity() * bits_per_word; }
+    void shrink_to_fit() { words.shrink_to_fit(); }
+
+    // One past the largest key that could currently be stored without growing
+    size_type end_index() const { return words.size() * bits_per_word; }
+
+    // Modifiers
+    void clear() {
+        words.clear();
+        rank_cache.invalidate();
+    }
+
+    // Returns true if pos was not already present
+    bool insert(size_type pos) {
+        size_type word_index = pos / bits_per_word;
+        if (word_index >= words.size()) {
+            words.resize(word_index + 1);
+        }
+        uint64_t mask = uint64_t{1} << (pos % bits_per_word);
+        bool inserted = !(words[word_index] & mask);
+        words[word_index] |= mask;
+        if (inserted) {
+            rank_cache.invalidate();
+        }
+        return inserted;
+    }
+
+    // Returns true if pos was present
+    bool erase(size_type pos) {
+        if (!contains(pos)) {
+            return false;
+        }
+        words[pos / bits_per_word] &= ~(uint64_t{1} << (pos % bits_per_word));
+        trim();
+        return true;
+    }
+
+    void swap(SparseSet& other) {
+        words.swap(other.words);
+        rank_cache.invalidate();
+        other.rank_cache.invalidate();
+    }
+
+    // Lookup
+    bool contains(size_type pos) const {
+        size_type word_index = pos / bits_per_word;
+        return word_index < words.size() && (words[word_index] >> (pos % bits_per_word)) & 1;
+    }
+
+    const_iterator find(size_type pos) const {
+        return contains(pos) ? const_iterator(this, pos) : end();
+    }
+
+    // Number of keys below pos; O(1) once the rank blocks are built after a modification. Safe to
+    // call from several threads at once.
+    size_type rank(size_type pos) const {
+        rank_cache.ensure([&](std::vector<uint64_t>&, std::vector<size_t>& blocks) {
+            sparse_bits::build_rank_blocks(words, blocks);
+        });
+        return sparse_bits::rank(words, rank_cache.blocks(), pos);
+    }
+
+    // The n-th smallest key, counting from zero
+    size_type select(size_type n) const {
+        if (n >= rank(end_index())) {
+            throw std::out_of_range("SparseSet::select: n (which is " + std::to_string(n)
+                                    + ") >= this->size()");
+        }
+        return sparse_bits::select(words, rank_cache.blocks(), n);
+    }
+
+    // Set algebra, word at a time
+    SparseSet& operator|=(const SparseSet& other) {
+        if (other.words.size() > words.size()) {
+            words.resize(other.words.size());
+        }
+        for (size_t i = 0; i < other.words.size(); ++i) {
+            words[i] |= other.words[i];
+        }
+        rank_cache.invalidate();
+        return *this;
+    }
+
+    SparseSet& operator&=(const SparseSet& other) {
+        words.resize(std::min(words.size(), other.words.size()));
+        for (size_t i = 0; i < words.size(); ++i) {
+            words[i] &= other.words[i];
+        }
+        trim();
+        return *this;
+    }
+
+    SparseSet& operator-=(const SparseSet& other) {
+        size_t common = std::min(words.size(), other.words.size());
+        for (size_t i = 0; i < common; ++i) {
+            words[i] &= ~other.words[i];
+        }
+        trim();
+        return *this;
+    }
+
+    SparseSet& operator^=(const SparseSet& other) {
+        if (other.words.size() > words.size()) {
+            words.resize(other.words.size());
+        }
+        for (size_t i = 0; i < other.words.size(); ++i) {
+            words[i] ^= other.words[i];
+        }
+        trim();
+        return *this;
+    }
+
+    friend SparseSet operator|(SparseSet lhs, const SparseSet& rhs) { return lhs |= rhs; }
+    friend SparseSet operator&(SparseSet lhs, const SparseSet& rhs) { return lhs &= rhs; }
+    friend SparseSet operator-(SparseSet lhs, const SparseSet& rhs) { return lhs -= rhs; }
+    friend SparseSet operator^(SparseSet lhs, const SparseSet& rhs) { return lhs ^= rhs; }
+
+    bool operator==(const SparseSet& other) const { return words == other.words; }
+    bool operator!=(const SparseSet& other) const { return !(*this == other); }
+
+    // Memory usage calculation
+    size_t memory_usage() const {
+        return words.capacity() * sizeof(uint64_t);
+    }
+};
+
+#endif //SPARSESET_HPP_
@@ -0,0 +1,274 @@
+#ifndef SPARSESTRINGVECTOR_HPP_
+#define SPARSESTRINGVECTOR_HPP_
+
+#include <vector>
+#include <optional>
+#include <stdexcept>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+
+// SparseVector for variable-length values (strings or raw bytes). Payloads live back to back in
+// a single arena and each occupied index maps to an (offset, length) slot, so inserts do not
+// allocate per element. Values are returned as string_views into the arena, which are
+// invalidated by any modification.
+class SparseStringVector {
+  private:
+    struct Slot {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    std::vector<char> arena;
+    std::vector<Slot> slots;
+    std::vector<size_t> slot_keys;
+    std::vector<std::optional<uint32_t>> indices;
+    size_t dead_bytes = 0;
+
+    // Compact automatically once holes make up most of the arena
+    void maybe_compact() {
+        if (dead_bytes > 4096 && dead_bytes > arena.size() / 2) {
+            compact();
+        }
+    }
+
+    uint32_t append(std::string_view value) {
+        if (arena.size() + value.size() > UINT32_MAX) {
+            throw std::length_error("SparseStringVector: arena exceeds 4 GiB");
+        }
+        // value may point into the arena itself, which append can reallocate
+        const char* arena_begin = arena.data();
+        bool aliases = !value.empty() && value.data() >= arena_begin && value.data() < arena_begin + arena.size();
+        size_t alias_offset = aliases ? static_cast<size_t>(value.data() - arena_begin) : 0;
+        uint32_t offset = static_cast<uint32_t>(arena.size());
+        arena.resize(arena.size() + value.size());
+        const char* source = aliases ? arena.data() + alias_offset : value.data();
+        if (!value.empty()) {
+            std::memcpy(arena.data() + offset, source, value.size());
+        }
+        return offset;
+    }
+
+  public:
+    using value_type = std::string_view;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    class Iterator {
+      private:
+        const SparseStringVector* container;
+        size_t current_index;
+
+        void advance_to_valid() {
+            while (current_index < container->indices.size() && !container->indices[current_index].has_value()) {
+                ++current_index;
+            }
+        }
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::string_view;
+
+        Iterator(const SparseStringVector* cont, size_t index) : container(cont), current_index(index) {
+            advance_to_valid();
+        }
+
+        reference operator*() const {
+            return container->view(*container->indices[current_index]);
+        }
+
+        // Sparse index of the current element
+        size_type index() const {
+            return current_index;
+        }
+
+        Iterator& operator++() {
+            ++current_index;
+            advance_to_valid();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return container == other.container && current_index == other.current_index;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator cbegin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, indices.size()); }
+    const_iterator cend() const { return const_iterator(this, indices.size()); }
+
+    // Constructors
+    SparseStringVector() = default;
+    explicit SparseStringVector(size_type n) : indices(n) {}
+
+    // Element access
+    std::string_view at(size_type pos) const {
+        if (pos >= indices.size() || !indices[pos].has_value()) {
+            throw std::out_of_range("SparseStringVector::at: pos (which is "
+                                    + std::to_string(pos) + ") is not set");
+        }
+        return view(*indices[pos]);
+    }
+
+    std::string_view operator[](size_type pos) const {
+        return at(pos);
+    }
+
+    // Capacity
+    bool empty() const { return slots.empty(); }
+    size_type size() const { return slots.size(); }
+    size_type max_size() const { return indices.max_size(); }
+    // Bytes held by the arena, including holes
+    size_t arena_size() const { return arena.size(); }
+    // Bytes left behind by erased or overwritten values until the next compact()
+    size_t wasted_bytes() const { return dead_bytes; }
+
+    void reserve(size_type count, size_t bytes) {
+        slots.reserve(count);
+        slot_keys.reserve(count);
+        arena.reserve(bytes);
+    }
+
+    void shrink_to_fit() {
+        compact();
+        arena.shrink_to_fit();
+        slots.shrink_to_fit();
+        slot_keys.shrink_to_fit();
+        while (!indices.empty() && !indices.back().has_value()) {
+            indices.pop_back();
+        }
+        indices.shrink_to_fit();
+    }
+
+    // Modifiers
+    void clear() {
+        arena.clear();
+        slots.clear();
+        slot_keys.clear();
+        indices.clear();
+        dead_bytes = 0;
+    }
+
+    void insert(size_type pos, std::string_view value) {
+        if (pos >= indices.size()) {
+            indices.resize(pos + 1);
+        }
+        if (!indices[pos].has_value()) {
+            uint32_t offset = append(value);
+            indices[pos] = static_cast<uint32_t>(slots.size());
+            slots.push_back({offset, static_cast<uint32_t>(value.size())});
+            slot_keys.push_back(pos);
+            return;
+        }
+
+        Slot& slot = slots[*indices[pos]];
+        if (value.size() <= slot.length) {
+            // Shrinking values are rewritten in place
+            if (!value.empty()) {
+                std::memmove(arena.data() + slot.offset, value.data(), value.size());
+            }
+            dead_bytes += slot.length - value.size();
+            slot.length = static_cast<uint32_t>(value.size());
+        } else {
+            uint32_t old_length = slot.length;
+            uint32_t offset = append(value);
+            Slot& grown = slots[*indices[pos]];
+            grown.offset = offset;
+            grown.length = static_cast<uint32_t>(value.size());
+            dead_bytes += old_length;
+        }
+        maybe_compact();
+    }
+
+    void erase(size_type pos) {
+        if (!contains(pos)) {
+            return;
+        }
+        uint32_t slot_index = *indices[pos];
+        dead_bytes += slots[slot_index].length;
+
+        // Fill the hole with the last slot so slots stay dense
+        uint32_t last = static_cast<uint32_t>(slots.size() - 1);
+        if (slot_index != last) {
+            slots[slot_index] = slots[last];
+            slot_keys[slot_index] = slot_keys[last];
+            indices[slot_keys[slot_index]] = slot_index;
+        }
+        slots.pop_back();
+        slot_keys.pop_back();
+        indices[pos] = std::nullopt;
+        maybe_compact();
+    }
+
+    // Rewrites the arena without holes, in slot order
+    void compact() {
+        if (dead_bytes == 0) {
+            return;
+        }
+        std::vector<char> packed;
+        packed.reserve(arena.size() - dead_bytes);
+        for (Slot& slot : slots) {
+            uint32_t offset = static_cast<uint32_t>(packed.size());
+            packed.insert(packed.end(), arena.begin() + slot.offset, arena.begin() + slot.offset + slot.length);
+            slot.offset = offset;
+        }
+        arena.swap(packed);
+        dead_bytes = 0;
+    }
+
+    void swap(SparseStringVector& other) {
+        arena.swap(other.arena);
+        slots.swap(other.slots);
+        slot_keys.swap(other.slot_keys);
+        indices.swap(other.indices);
+        std::swap(dead_bytes, other.dead_bytes);
+    }
+
+    // Lookup
+    bool contains(size_type pos) const {
+        return (pos < indices.size() && indices[pos].has_value());
+    }
+
+    const_iterator find(size_type pos) const {
+        if (contains(pos)) {
+            return const_iterator(this, pos);
+        }
+        return end();
+    }
+
+    // Memory usage calculation: arena bytes, then slot and index storage
+    std::pair<size_t, size_t> memory_usage() const {
+        return {
+            arena.capacity(),
+            slots.capacity() * sizeof(Slot) + slot_keys.capacity() * sizeof(size_t)
+                + indices.capacity() * sizeof(std::optional<uint32_t>)
+        };
+    }
+
+  private:
+    std::string_view view(uint32_t slot_index) const {
+        const Slot& slot = slots[slot_index];
+        return std::string_view(arena.data() + slot.offset, slot.length);
+    }
+};
+
+#endif //SPARSESTRINGVECTOR_HPP_
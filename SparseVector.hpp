@@ -10,6 +10,25 @@
 #include <stdexcept>
 #include <algorithm>
 #include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <exception>
+#if __cplusplus >= 202002L
+#include <ranges>
+#endif
+#if __has_include(<generator>)
+#include <generator>
+#endif
+#include "SparseSet.hpp"
+#include "SparseParallel.hpp"
 
 // Helper to check if T has a memory_usage() method
 template<typename T, typename = void>
@@ -18,13 +37,46 @@ struct has_memory_usage : std::false_type {};
 template<typename T>
 struct has_memory_usage<T, std::void_t<decltype(std::declval<T>().memory_usage())>> : std::true_type {};
 
+// Types whose objects can be moved to a new address by copying their bytes, e.g. types that
+// only hold a pointer to their own heap buffer. Specialise to std::true_type to opt a type in.
+template<typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template<typename T>
+class SparseVectorView;
+
+// Base for the lazy ranges returned by items(): marks them as views under C++20 so they compose
+// with std::views adaptors, and is empty under C++17
+#ifdef __cpp_lib_ranges
+using sparse_view_base = std::ranges::view_base;
+#else
+struct sparse_view_base {};
+#endif
+
 template<typename T>
 class SparseVector {
   private:
+    template<typename> friend class SparseVectorView;
+
     std::vector<T> objects;
     std::vector<std::optional<uint32_t>> indices;
     size_t max_index = 0;
 
+    // Occupancy bitmap and block ranks for rank()/select(), rebuilt lazily after modifications
+    sparse_bits::RankCache rank_cache;
+
+    void build_rank_index() const {
+        rank_cache.ensure([&](std::vector<uint64_t>& words, std::vector<size_t>& blocks) {
+            words.assign((indices.size() + 63) / 64, 0);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                if (indices[i].has_value()) {
+                    words[i / 64] |= uint64_t{1} << (i % 64);
+                }
+            }
+            sparse_bits::build_rank_blocks(words, blocks);
+        });
+    }
+
     // Helper function to get memory usage of T
     static size_t get_object_memory_usage() {
         if constexpr (has_memory_usage<T>::value) {
@@ -34,6 +86,327 @@ class SparseVector {
         }
     }
 
+    // Checks that a key from another container is usable as an index
+    template<typename K>
+    static size_t checked_key(const K& key) {
+        if constexpr (std::is_signed<K>::value) {
+            if (key < 0) {
+                throw std::out_of_range("SparseVector: negative key " + std::to_string(key));
+            }
+        }
+        return static_cast<size_t>(key);
+    }
+
+    // Fills an empty container from (key, value) pairs whose largest key is max_key, moving the
+    // values out when the source is an rvalue
+    template<typename Source>
+    void assign_pairs(Source&& source, size_t max_key) {
+        indices.resize(max_key + 1);
+        objects.reserve(source.size());
+        max_index = max_key;
+        for (auto& entry : source) {
+            size_t key = checked_key(entry.first);
+            if (!indices[key].has_value()) {
+                indices[key] = static_cast<uint32_t>(objects.size());
+                if constexpr (std::is_rvalue_reference<Source&&>::value) {
+                    objects.push_back(std::move(entry.second));
+                } else {
+                    objects.push_back(entry.second);
+                }
+            }
+        }
+    }
+
+    // Calls f(index, object position) for every occupied index in ascending order, prefetching
+    // the object a few indices ahead since object positions do not follow index order
+    template<typename F>
+    void for_each_slot(F&& f) const {
+        constexpr size_t prefetch_distance = 16;
+        size_t n = indices.size();
+        for (size_t i = 0; i < n; ++i) {
+#if defined(__GNUC__) || defined(__clang__)
+            if (i + prefetch_distance < n && indices[i + prefetch_distance].has_value()) {
+                __builtin_prefetch(objects.data() + *indices[i + prefetch_distance]);
+            }
+#endif
+            if (indices[i].has_value()) {
+                f(i, *indices[i]);
+            }
+        }
+    }
+
+    // One past the largest occupied index
+    size_t occupied_end() const {
+        size_t end = indices.size();
+        while (end > 0 && !indices[end - 1].has_value()) {
+            --end;
+        }
+        return end;
+    }
+
+    void check_dense_size(const char* function, size_t dense_size) const {
+        size_t needed = occupied_end();
+        if (dense_size < needed) {
+            throw std::out_of_range(std::string("SparseVector::") + function + ": dense size (which is "
+                                    + std::to_string(dense_size) + ") < largest index + 1 (which is "
+                                    + std::to_string(needed) + ")");
+        }
+    }
+
+    // Offers object position slot to heap, which keeps the k best positions seen with the worst
+    // of them at the front, so each further object costs one comparison against that threshold
+    template<typename Compare>
+    void offer_top(std::vector<uint32_t>& heap, size_t k, uint32_t slot, Compare& cmp) const {
+        auto better = [&](uint32_t a, uint32_t b) { return cmp(objects[a], objects[b]); };
+        if (heap.size() < k) {
+            heap.push_back(slot);
+            std::push_heap(heap.begin(), heap.end(), better);
+        } else if (k != 0 && better(slot, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = slot;
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+
+    // Orders the kept positions best first and looks up their indices in one pass over indices
+    template<typename Compare>
+    std::vector<std::pair<size_t, T>> finish_top(std::vector<uint32_t>& heap, Compare& cmp) const {
+        std::sort_heap(heap.begin(), heap.end(), [&](uint32_t a, uint32_t b) { return cmp(objects[a], objects[b]); });
+
+        std::vector<std::pair<uint32_t, size_t>> by_slot(heap.size());
+        for (size_t rank = 0; rank < heap.size(); ++rank) {
+            by_slot[rank] = {heap[rank], rank};
+        }
+        std::sort(by_slot.begin(), by_slot.end());
+        std::vector<size_t> keys(heap.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].has_value()) {
+                auto it = std::lower_bound(by_slot.begin(), by_slot.end(), std::make_pair(*indices[i], size_t{0}));
+                if (it != by_slot.end() && it->first == *indices[i]) {
+                    keys[it->second] = i;
+                }
+            }
+        }
+
+        std::vector<std::pair<size_t, T>> result;
+        result.reserve(heap.size());
+        for (size_t rank = 0; rank < heap.size(); ++rank) {
+            result.emplace_back(keys[rank], objects[heap[rank]]);
+        }
+        return result;
+    }
+
+    template<typename Map>
+    static size_t max_key_of(const Map& map) {
+        size_t max_key = 0;
+        for (const auto& entry : map) {
+            max_key = std::max(max_key, checked_key(entry.first));
+        }
+        return max_key;
+    }
+
+    template<typename Dense>
+    void assign_dense(Dense&& dense) {
+        size_t count = std::count_if(dense.begin(), dense.end(),
+                                     [](const std::optional<T>& value) { return value.has_value(); });
+        indices.resize(dense.size());
+        objects.reserve(count);
+        max_index = dense.empty() ? 0 : dense.size() - 1;
+        for (size_t i = 0; i < dense.size(); ++i) {
+            if (dense[i].has_value()) {
+                indices[i] = static_cast<uint32_t>(objects.size());
+                if constexpr (std::is_rvalue_reference<Dense&&>::value) {
+                    objects.push_back(std::move(*dense[i]));
+                } else {
+                    objects.push_back(*dense[i]);
+                }
+            }
+        }
+    }
+
+    // Removes objects[obj_index] and shifts the tail down one slot
+    void erase_object(size_t obj_index) {
+        if constexpr (is_trivially_relocatable<T>::value && !std::is_trivially_copyable<T>::value) {
+            // Rotate the erased object's bytes to the back with one memmove instead of
+            // move-assigning every element of the tail, then let pop_back() destroy it.
+            alignas(T) unsigned char erased[sizeof(T)];
+            T* hole = objects.data() + obj_index;
+            std::memcpy(erased, static_cast<void*>(hole), sizeof(T));
+            std::memmove(static_cast<void*>(hole), static_cast<void*>(hole + 1),
+                         (objects.size() - obj_index - 1) * sizeof(T));
+            std::memcpy(static_cast<void*>(objects.data() + objects.size() - 1), erased, sizeof(T));
+            objects.pop_back();
+        } else {
+            objects.erase(objects.begin() + obj_index);
+        }
+    }
+
+    // Shared body of the apply_batch() overloads; Move says whether update values may be moved from
+    template<bool Move, typename Updates, typename Combine>
+    void apply_updates(Updates& updates, Combine& combine) {
+        size_t n = updates.size();
+        if (n == 0) {
+            return;
+        }
+
+        // Everything that can fail to allocate happens before any element is touched
+        if (n > UINT32_MAX) {
+            throw std::length_error("SparseVector::apply_batch: too many updates");
+        }
+        size_t max_insert_key = 0;
+        size_t inserts = 0;
+        bool combines = false;
+        for (size_t i = 0; i < n; ++i) {
+            if (updates[i].op != BatchOp::Erase) {
+                max_insert_key = std::max(max_insert_key, updates[i].key);
+                ++inserts;
+            }
+            combines |= updates[i].op == BatchOp::Combine;
+        }
+        // An insert adds an object only when its key is absent as it is applied: absent before the
+        // batch, or erased earlier in it. Counting that needs a probe of the index, which is only
+        // made when the cheap bound (every insert) would outgrow the storage.
+        size_t added = inserts;
+        if (objects.size() + added > objects.capacity()) {
+            added = n - inserts;
+            for (size_t i = 0; i < n; ++i) {
+                size_t key = updates[i].key;
+                if (updates[i].op != BatchOp::Erase && (key >= indices.size() || !indices[key].has_value())) {
+                    ++added;
+                }
+            }
+            added = std::min(added, inserts);
+        }
+        if (objects.size() + added > UINT32_MAX) {
+            throw std::length_error("SparseVector::apply_batch: too many values to index");
+        }
+        constexpr bool can_combine = std::is_invocable_r<T, Combine&, T&, const T&>::value;
+        if (!can_combine && combines) {
+            throw std::invalid_argument("SparseVector::apply_batch: Combine update but combine cannot merge these values");
+        }
+
+        bool erases = inserts != n;
+        std::vector<bool> dead(erases ? objects.size() + added : 0);
+        std::vector<uint32_t> new_slot(erases ? objects.size() + added : 0);
+        std::vector<unsigned char> graveyard;
+        if constexpr (is_trivially_relocatable<T>::value && !std::is_trivially_copyable<T>::value) {
+            graveyard.resize((n - inserts) * sizeof(T));
+        }
+        if (inserts != 0 && max_insert_key >= indices.size()) {
+            indices.resize(max_insert_key + 1);
+        }
+        if (objects.size() + added > objects.capacity()) {
+            objects.reserve(std::max(objects.size() + added, objects.capacity() * 2));
+        }
+        if (inserts != 0) {
+            max_index = std::max(max_index, max_insert_key);
+        }
+        rank_cache.invalidate();
+
+        // Updates are applied in submission order; sorting them by key measured slower than the
+        // random accesses it saves. The index entry of an update a few places ahead is prefetched,
+        // and the object it refers to once that entry has had time to arrive.
+        auto take = [](auto& value) -> std::conditional_t<Move, T&&, const T&> {
+            if constexpr (Move) {
+                return std::move(value);
+            } else {
+                return value;
+            }
+        };
+        constexpr size_t prefetch_distance = 16;
+        size_t erased = 0;
+        for (size_t i = 0; i < n; ++i) {
+#if defined(__GNUC__) || defined(__clang__)
+            if (i + prefetch_distance < n) {
+                size_t ahead = updates[i + prefetch_distance].key;
+                if (ahead < indices.size()) {
+                    __builtin_prefetch(indices.data() + ahead);
+                }
+            }
+            if (i + prefetch_distance / 2 < n) {
+                size_t ahead = updates[i + prefetch_distance / 2].key;
+                if (ahead < indices.size() && indices[ahead].has_value()) {
+                    __builtin_prefetch(objects.data() + *indices[ahead]);
+                }
+            }
+#endif
+            auto& update = updates[i];
+            size_t key = update.key;
+            if (update.op == BatchOp::Erase) {
+                if (key < indices.size() && indices[key].has_value()) {
+                    dead[*indices[key]] = true;
+                    indices[key] = std::nullopt;
+                    ++erased;
+                }
+                continue;
+            }
+            auto& slot = indices[key];
+            if (!slot.has_value()) {
+                slot = static_cast<uint32_t>(objects.size());
+                objects.push_back(take(update.value));
+            } else if (update.op == BatchOp::Combine) {
+                if constexpr (can_combine) {
+                    objects[*slot] = combine(objects[*slot], take(update.value));
+                }
+            } else {
+                objects[*slot] = take(update.value);
+            }
+        }
+
+        // Close the holes left by erased objects in one pass, keeping the survivors in order
+        if (erased != 0) {
+            size_t live = 0;
+            for (size_t i = 0; i < objects.size(); ++i) {
+                if (!dead[i]) {
+                    new_slot[i] = static_cast<uint32_t>(live++);
+                }
+            }
+            if constexpr (is_trivially_relocatable<T>::value && !std::is_trivially_copyable<T>::value) {
+                // As in erase_object(): the dead objects' bytes are parked aside while each run of
+                // survivors is memmoved down, then put back behind the survivors for erase() to
+                // destroy, so no survivor is move-assigned
+                T* data = objects.data();
+                size_t size = objects.size();
+                size_t out = 0;
+                size_t parked = 0;
+                for (size_t i = 0; i < size;) {
+                    size_t run = i;
+                    if (dead[i]) {
+                        while (run < size && dead[run]) {
+                            ++run;
+                        }
+                        std::memcpy(graveyard.data() + parked * sizeof(T), static_cast<void*>(data + i),
+                                    (run - i) * sizeof(T));
+                        parked += run - i;
+                    } else {
+                        while (run < size && !dead[run]) {
+                            ++run;
+                        }
+                        if (out != i) {
+                            std::memmove(static_cast<void*>(data + out), static_cast<void*>(data + i),
+                                         (run - i) * sizeof(T));
+                        }
+                        out += run - i;
+                    }
+                    i = run;
+                }
+                std::memcpy(static_cast<void*>(data + live), graveyard.data(), parked * sizeof(T));
+            } else {
+                for (size_t i = 0; i < objects.size(); ++i) {
+                    if (!dead[i] && new_slot[i] != i) {
+                        objects[new_slot[i]] = std::move(objects[i]);
+                    }
+                }
+            }
+            objects.erase(objects.begin() + live, objects.end());
+            for (auto& index : indices) {
+                if (index.has_value()) {
+                    index = new_slot[*index];
+                }
+            }
+        }
+    }
+
   public:
     // Type definitions to match standard container interface
     using value_type = T;
@@ -65,6 +438,8 @@ class SparseVector {
         using pointer = value_type*;
         using reference = value_type&;
 
+        Iterator() : container(nullptr), current_index(0) {}
+
         Iterator(ContainerType* cont, size_t index) : container(cont), current_index(index) {
             advance_to_valid();
         }
@@ -77,6 +452,11 @@ class SparseVector {
             return &(operator*());
         }
 
+        // Sparse index of the current element
+        size_type index() const {
+            return current_index;
+        }
+
         Iterator& operator++() {
             ++current_index;
             advance_to_valid();
@@ -101,6 +481,76 @@ class SparseVector {
     using iterator = Iterator<false>;
     using const_iterator = Iterator<true>;
 
+    // Iterates (index, reference) pairs, produced on the fly from the underlying iterator
+    template<bool IsConst>
+    class ItemIterator {
+      private:
+        Iterator<IsConst> it;
+
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type = std::pair<size_type, std::conditional_t<IsConst, const T&, T&>>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        ItemIterator() = default;
+        explicit ItemIterator(Iterator<IsConst> it) : it(it) {}
+
+        reference operator*() const {
+            return {it.index(), *it};
+        }
+
+        ItemIterator& operator++() {
+            ++it;
+            return *this;
+        }
+
+        ItemIterator operator++(int) {
+            ItemIterator tmp = *this;
+            ++it;
+            return tmp;
+        }
+
+        bool operator==(const ItemIterator& other) const { return it == other.it; }
+        bool operator!=(const ItemIterator& other) const { return it != other.it; }
+    };
+
+    // Lazy range of (index, value) pairs; no element is copied and nothing is allocated
+    template<bool IsConst>
+    class ItemRange : public sparse_view_base {
+      private:
+        using ContainerType = std::conditional_t<IsConst, const SparseVector, SparseVector>;
+        ContainerType* container = nullptr;
+
+      public:
+        ItemRange() = default;
+        explicit ItemRange(ContainerType* container) : container(container) {}
+
+        ItemIterator<IsConst> begin() const {
+            return ItemIterator<IsConst>(Iterator<IsConst>(container, 0));
+        }
+
+        ItemIterator<IsConst> end() const {
+            return ItemIterator<IsConst>(Iterator<IsConst>(container, container->max_index + 1));
+        }
+    };
+
+    ItemRange<false> items() { return ItemRange<false>(this); }
+    ItemRange<true> items() const { return ItemRange<true>(this); }
+
+#ifdef __cpp_lib_generator
+    // Coroutine traversal of (index, value) pairs, suspended between elements
+    std::generator<std::pair<size_type, const T&>> stream() const {
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].has_value()) {
+                co_yield std::pair<size_type, const T&>(i, objects[*indices[i]]);
+            }
+        }
+    }
+#endif
+
     iterator begin() { return iterator(this, 0); }
     const_iterator begin() const { return const_iterator(this, 0); }
     const_iterator cbegin() const { return const_iterator(this, 0); }
@@ -113,6 +563,203 @@ class SparseVector {
     SparseVector() = default;
     explicit SparseVector(size_type n) : indices(n) {}
 
+    // Adopts values without copying them; values[i] is stored at index keys[i]
+    SparseVector(const std::vector<size_type>& keys, std::vector<T>&& values) {
+        if (keys.size() != values.size()) {
+            throw std::invalid_argument("SparseVector: keys (size " + std::to_string(keys.size())
+                                        + ") and values (size " + std::to_string(values.size()) + ") differ in size");
+        }
+        if (keys.size() > UINT32_MAX) {
+            throw std::length_error("SparseVector: too many values to index");
+        }
+        if (!keys.empty()) {
+            max_index = *std::max_element(keys.begin(), keys.end());
+            indices.resize(max_index + 1);
+        }
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (indices[keys[i]].has_value()) {
+                throw std::invalid_argument("SparseVector: duplicate key " + std::to_string(keys[i]));
+            }
+            indices[keys[i]] = static_cast<uint32_t>(i);
+        }
+        objects = std::move(values);
+    }
+
+    // Copies other using `threads` threads (0 = one per hardware thread); see assign_parallel()
+    SparseVector(const SparseVector& other, unsigned threads) {
+        assign_parallel(other, threads);
+    }
+
+    // Builds a container from unsorted keys and values using `threads` threads (0 = one per
+    // hardware thread). The (key, value position) pairs are radix sorted and the values are then
+    // moved into place in key order, so the result iterates and stores values in the same order.
+    // As with repeated operator[] assignment, the last value given for a duplicate key wins.
+    static SparseVector build_parallel(const std::vector<size_type>& keys, std::vector<T>&& values,
+                                       unsigned threads = 0) {
+        if (keys.size() != values.size()) {
+            throw std::invalid_argument("SparseVector::build_parallel: keys (size " + std::to_string(keys.size())
+                                        + ") and values (size " + std::to_string(values.size()) + ") differ in size");
+        }
+        if (keys.size() > UINT32_MAX) {
+            throw std::length_error("SparseVector::build_parallel: too many values to index");
+        }
+        SparseVector result;
+        size_t n = keys.size();
+        if (n == 0) {
+            return result;
+        }
+        threads = sparse_parallel::resolve_threads(threads, n);
+
+        std::vector<sparse_parallel::KeyIndex> order(n);
+        sparse_parallel::parallel_for(n, threads, [&](size_t begin, size_t end, unsigned) {
+            for (size_t i = begin; i < end; ++i) {
+                order[i] = {keys[i], static_cast<uint32_t>(i)};
+            }
+        });
+        sparse_parallel::radix_sort(order, threads);
+
+        // The sort is stable, so the last entry of each run of equal keys is the newest value
+        size_t unique = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (i + 1 < n && order[i + 1].key == order[i].key) {
+                continue;
+            }
+            order[unique++] = order[i];
+        }
+        order.resize(unique);
+
+        result.max_index = order.back().key;
+        result.indices.resize(result.max_index + 1);
+        if constexpr (std::is_default_constructible<T>::value) {
+            result.objects.resize(unique);
+            sparse_parallel::parallel_for(unique, threads, [&](size_t begin, size_t end, unsigned) {
+                for (size_t i = begin; i < end; ++i) {
+                    result.objects[i] = std::move(values[order[i].index]);
+                    result.indices[order[i].key] = static_cast<uint32_t>(i);
+                }
+            });
+        } else {
+            result.objects.reserve(unique);
+            for (size_t i = 0; i < unique; ++i) {
+                result.objects.push_back(std::move(values[order[i].index]));
+                result.indices[order[i].key] = static_cast<uint32_t>(i);
+            }
+        }
+        return result;
+    }
+
+    // Bulk conversion from the standard containers. A std::map is already sorted, so its largest
+    // key is known up front and the values are appended in key order in a single pass.
+    template<typename K, typename Alloc>
+    explicit SparseVector(const std::map<K, T, std::less<K>, Alloc>& map) {
+        if (!map.empty()) {
+            checked_key(map.begin()->first);
+            assign_pairs(map, checked_key(map.rbegin()->first));
+        }
+    }
+
+    template<typename K, typename Alloc>
+    explicit SparseVector(std::map<K, T, std::less<K>, Alloc>&& map) {
+        if (!map.empty()) {
+            checked_key(map.begin()->first);
+            assign_pairs(std::move(map), checked_key(map.rbegin()->first));
+        }
+    }
+
+    template<typename K, typename Hash, typename KeyEqual, typename Alloc>
+    explicit SparseVector(const std::unordered_map<K, T, Hash, KeyEqual, Alloc>& map) {
+        if (!map.empty()) {
+            assign_pairs(map, max_key_of(map));
+        }
+    }
+
+    template<typename K, typename Hash, typename KeyEqual, typename Alloc>
+    explicit SparseVector(std::unordered_map<K, T, Hash, KeyEqual, Alloc>&& map) {
+        if (!map.empty()) {
+            size_t max_key = max_key_of(map);
+            assign_pairs(std::move(map), max_key);
+        }
+    }
+
+    explicit SparseVector(const std::vector<std::optional<T>>& dense) {
+        assign_dense(dense);
+    }
+
+    explicit SparseVector(std::vector<std::optional<T>>&& dense) {
+        assign_dense(std::move(dense));
+    }
+
+    // Bulk conversion to the standard containers; the rvalue overloads move the values out and
+    // leave this container empty
+    template<typename K = size_type>
+    std::map<K, T> to_map() const& {
+        std::map<K, T> result;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].has_value()) {
+                result.emplace_hint(result.end(), static_cast<K>(i), objects[*indices[i]]);
+            }
+        }
+        return result;
+    }
+
+    template<typename K = size_type>
+    std::map<K, T> to_map() && {
+        std::map<K, T> result;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].has_value()) {
+                result.emplace_hint(result.end(), static_cast<K>(i), std::move(objects[*indices[i]]));
+            }
+        }
+        clear();
+        return result;
+    }
+
+    template<typename K = size_type>
+    std::unordered_map<K, T> to_unordered_map() const& {
+        std::unordered_map<K, T> result;
+        result.reserve(size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].has_value()) {
+                result.emplace(static_cast<K>(i), objects[*indices[i]]);
+            }
+        }
+        return result;
+    }
+
+    template<typename K = size_type>
+    std::unordered_map<K, T> to_unordered_map() && {
+        std::unordered_map<K, T> result;
+        result.reserve(size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].has_value()) {
+                result.emplace(static_cast<K>(i), std::move(objects[*indices[i]]));
+            }
+        }
+        clear();
+        return result;
+    }
+
+    std::vector<std::optional<T>> to_optional_vector() const& {
+        std::vector<std::optional<T>> result(indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].has_value()) {
+                result[i].emplace(objects[*indices[i]]);
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::optional<T>> to_optional_vector() && {
+        std::vector<std::optional<T>> result(indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].has_value()) {
+                result[i].emplace(std::move(objects[*indices[i]]));
+            }
+        }
+        clear();
+        return result;
+    }
+
     // Element access
     T& at(size_type pos) {
         if (pos >= indices.size() || !indices[pos].has_value()) {
@@ -142,6 +789,7 @@ class SparseVector {
         if (!indices[pos].has_value()) {
             indices[pos] = objects.size();
             objects.emplace_back();
+            rank_cache.invalidate();
         }
         return objects[*indices[pos]];
     }
@@ -183,6 +831,7 @@ class SparseVector {
     void clear() {
         objects.clear();
         indices.clear();
+        rank_cache.invalidate();
     }
 
     void insert(size_t pos, const T& value) {
@@ -195,6 +844,7 @@ class SparseVector {
         if (!indices[pos].has_value()) {
             indices[pos] = objects.size();
             objects.push_back(value);
+            rank_cache.invalidate();
         } else {
             objects[*indices[pos]] = value;
         }
@@ -203,8 +853,9 @@ class SparseVector {
     void erase(size_type pos) {
         if (pos < indices.size() && indices[pos].has_value()) {
             size_type obj_index = *indices[pos];
-            objects.erase(objects.begin() + obj_index);
+            erase_object(obj_index);
             indices[pos] = std::nullopt;
+            rank_cache.invalidate();
 
             // Update indices for objects that have moved
             for (auto& index : indices) {
@@ -218,6 +869,7 @@ class SparseVector {
     void push_back(const T& value) {
         objects.push_back(value);
         indices.push_back(objects.size() - 1);
+        rank_cache.invalidate();
     }
 
     void pop_back() {
@@ -229,16 +881,519 @@ class SparseVector {
             if (!indices.empty()) {
                 indices.back() = std::nullopt;
             }
+            rank_cache.invalidate();
         }
     }
 
     void resize(size_type count) {
         indices.resize(count);
+        rank_cache.invalidate();
+    }
+
+    // Hands the dense storage back out, leaving the container empty: values in storage order and
+    // the index each one was stored at
+    std::pair<std::vector<size_type>, std::vector<T>> release() {
+        std::vector<size_type> keys(objects.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].has_value()) {
+                keys[*indices[i]] = i;
+            }
+        }
+        std::vector<T> values = std::move(objects);
+        clear();
+        max_index = 0;
+        return {std::move(keys), std::move(values)};
+    }
+
+    // Scatter/gather between the sparse values and a dense array indexed the same way. The dense
+    // array must cover every occupied index; it is walked in index order while the objects are
+    // prefetched ahead of use.
+
+    // dense[i] = (*this)[i] for every occupied index i
+    void scatter_to(std::vector<T>& dense) const {
+        check_dense_size("scatter_to", dense.size());
+        for_each_slot([&](size_t i, uint32_t slot) { dense[i] = objects[slot]; });
+    }
+
+    // dense[i] += (*this)[i] for every occupied index i
+    void scatter_add(std::vector<T>& dense) const {
+        check_dense_size("scatter_add", dense.size());
+        for_each_slot([&](size_t i, uint32_t slot) { dense[i] += objects[slot]; });
+    }
+
+    // (*this)[i] = dense[i] for every occupied index i; no indices are added
+    void gather_from(const std::vector<T>& dense) {
+        check_dense_size("gather_from", dense.size());
+        for_each_slot([&](size_t i, uint32_t slot) { objects[slot] = dense[i]; });
+    }
+
+    // The k best (index, value) pairs, best first, where cmp(a, b) means a is better than b; the
+    // default selects the largest values. Works on objects directly with a bounded heap.
+    template<typename Compare = std::greater<T>>
+    std::vector<std::pair<size_type, T>> top_k(size_type k, Compare cmp = Compare()) const {
+        std::vector<uint32_t> heap;
+        heap.reserve(std::min(k, objects.size()));
+        for (size_t slot = 0; slot < objects.size(); ++slot) {
+            offer_top(heap, k, static_cast<uint32_t>(slot), cmp);
+        }
+        return finish_top(heap, cmp);
+    }
+
+    // top_k() with each thread selecting from its own chunk of objects before the per-chunk
+    // winners are merged
+    template<typename Compare = std::greater<T>>
+    std::vector<std::pair<size_type, T>> top_k_parallel(size_type k, unsigned threads = 0,
+                                                        Compare cmp = Compare()) const {
+        threads = sparse_parallel::resolve_threads(threads, objects.size());
+        std::vector<std::vector<uint32_t>> heaps(threads);
+        sparse_parallel::parallel_for(objects.size(), threads, [&](size_t begin, size_t end, unsigned t) {
+            Compare local_cmp = cmp;
+            for (size_t slot = begin; slot < end; ++slot) {
+                offer_top(heaps[t], k, static_cast<uint32_t>(slot), local_cmp);
+            }
+        });
+
+        std::vector<uint32_t> heap;
+        heap.reserve(std::min(k, objects.size()));
+        for (const auto& chunk_heap : heaps) {
+            for (uint32_t slot : chunk_heap) {
+                offer_top(heap, k, slot, cmp);
+            }
+        }
+        return finish_top(heap, cmp);
+    }
+
+    enum class BatchOp { Overwrite, Combine, Erase };
+
+    // One entry for apply_batch(). Overwrite stores value, Combine stores combine(old, value) (or
+    // value when key is absent) and Erase removes key, ignoring value.
+    struct Update {
+        size_type key;
+        T value;
+        BatchOp op = BatchOp::Overwrite;
+    };
+
+    // Applies updates with the same result as applying them one at a time in order, prefetching
+    // the index entries and objects of the updates ahead. Storage is grown once up front (only
+    // for keys that are actually new), and erased objects are compacted once at the end instead
+    // of per erase.
+    template<typename Combine = std::plus<>>
+    void apply_batch(std::vector<Update>&& updates, Combine combine = Combine()) {
+        apply_updates<true>(updates, combine);
+    }
+
+    template<typename Combine = std::plus<>>
+    void apply_batch(const std::vector<Update>& updates, Combine combine = Combine()) {
+        apply_updates<false>(updates, combine);
+    }
+
+    // Immutable version of a container for readers on other threads: a shared base plus a sorted
+    // run of changes on top of it. Publishing a commit builds a new Snapshot that shares the base
+    // and merges the commit into the changes, so it costs O(changes) rather than a copy of the
+    // container; once the changes outgrow a fraction of the base they are folded into a new base.
+    // Readers std::atomic_load() the current std::shared_ptr<const Snapshot> and keep it as long
+    // as they read from it.
+    class Snapshot {
+      public:
+        struct Change {
+            size_type key;
+            std::optional<T> value;  // empty for an erase
+        };
+
+      private:
+        friend class SparseVector;
+
+        static constexpr size_t fold_ratio = 64;
+        static constexpr size_t min_fold_changes = 4096;
+
+        std::shared_ptr<const SparseVector> base;
+        std::vector<Change> changes;  // sorted by key, one per key
+        size_type count = 0;
+
+        const Change* find_change(size_type key) const {
+            auto it = std::lower_bound(changes.begin(), changes.end(), key,
+                                       [](const Change& change, size_type k) { return change.key < k; });
+            return it != changes.end() && it->key == key ? &*it : nullptr;
+        }
+
+        // This version with delta (sorted by key, one per key) applied on top
+        std::shared_ptr<const Snapshot> with(const std::vector<Change>& delta) const {
+            auto next = std::make_shared<Snapshot>();
+            next->count = count;
+            for (const Change& change : delta) {
+                bool was_present = contains(change.key);
+                next->count += change.value.has_value() && !was_present;
+                next->count -= !change.value.has_value() && was_present;
+            }
+            next->changes.reserve(changes.size() + delta.size());
+            auto old_it = changes.begin();
+            for (const Change& change : delta) {
+                while (old_it != changes.end() && old_it->key < change.key) {
+                    next->changes.push_back(*old_it++);
+                }
+                if (old_it != changes.end() && old_it->key == change.key) {
+                    ++old_it;
+                }
+                next->changes.push_back(change);
+            }
+            next->changes.insert(next->changes.end(), old_it, changes.end());
+
+            if (next->changes.size() > std::max(min_fold_changes, base->size() / fold_ratio)) {
+                std::vector<Update> updates;
+                updates.reserve(next->changes.size());
+                for (Change& change : next->changes) {
+                    updates.push_back(change.value.has_value()
+                                      ? Update{change.key, std::move(*change.value), BatchOp::Overwrite}
+                                      : Update{change.key, T{}, BatchOp::Erase});
+                }
+                auto folded = std::make_shared<SparseVector>(*base);
+                folded->apply_batch(std::move(updates));
+                next->base = std::move(folded);
+                next->changes.clear();
+            } else {
+                next->base = base;
+            }
+            return next;
+        }
+
+      public:
+        Snapshot() : base(std::make_shared<const SparseVector>()) {}
+        explicit Snapshot(SparseVector contents)
+            : base(std::make_shared<const SparseVector>(std::move(contents))), count(base->size()) {}
+
+        // Pointer to the value at key in this version, or nullptr
+        const T* find(size_type key) const {
+            if (const Change* change = find_change(key)) {
+                return change->value.has_value() ? &*change->value : nullptr;
+            }
+            return base->contains(key) ? &(*base)[key] : nullptr;
+        }
+
+        bool contains(size_type key) const { return find(key) != nullptr; }
+
+        const T& at(size_type key) const {
+            const T* value = find(key);
+            if (value == nullptr) {
+                throw std::out_of_range("SparseVector::Snapshot::at: key " + std::to_string(key) + " is not present");
+            }
+            return *value;
+        }
+
+        size_type size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        // Number of changes not yet folded into the base
+        size_type pending_changes() const { return changes.size(); }
+    };
+
+    // Group of inserts and erases staged on the side and applied all at once by commit(). Until
+    // then the container is untouched, and discarding the transaction (or rollback()) drops the
+    // staged changes. commit() either applies every change or, if it throws, none of them.
+    //
+    // A transaction on a plain container commits in place (or through a copy move-assigned over
+    // it), so like every other modifier it must not run while other threads read the container.
+    // For concurrent readers, publish the contents as a std::shared_ptr<const Snapshot> that
+    // readers std::atomic_load(); transaction(published) then reads from the version current
+    // when it began and commits by swapping in a new Snapshot with a compare-and-swap, so a
+    // reader sees either none or all of a commit. A commit that lost a race to another writer is
+    // merged into the newer version instead.
+    class Transaction {
+      private:
+        SparseVector* target;
+        std::shared_ptr<const Snapshot>* published = nullptr;
+        std::shared_ptr<const Snapshot> base;  // version read from when publishing
+        std::vector<Update> staged;
+        std::unordered_map<size_type, size_t> latest;  // key -> its last entry in staged
+
+        void stage(Update&& update) {
+            latest[update.key] = staged.size();
+            staged.push_back(std::move(update));
+        }
+
+        void publish() {
+            std::vector<typename Snapshot::Change> delta;
+            delta.reserve(latest.size());
+            for (const auto& [key, position] : latest) {
+                Update& update = staged[position];
+                delta.push_back({key, update.op == BatchOp::Erase ? std::nullopt : std::optional<T>(std::move(update.value))});
+            }
+            std::sort(delta.begin(), delta.end(),
+                      [](const auto& a, const auto& b) { return a.key < b.key; });
+            std::shared_ptr<const Snapshot> current = std::atomic_load(published);
+            for (;;) {
+                std::shared_ptr<const Snapshot> next = current->with(delta);
+                if (std::atomic_compare_exchange_strong(published, &current, next)) {
+                    base = std::move(next);
+                    return;
+                }
+            }
+        }
+
+      public:
+        explicit Transaction(SparseVector& target) : target(&target) {}
+
+        explicit Transaction(std::shared_ptr<const Snapshot>& published)
+            : target(nullptr), published(&published), base(std::atomic_load(&published)) {}
+
+        void insert(size_type key, T value) { stage({key, std::move(value), BatchOp::Overwrite}); }
+        void erase(size_type key) { stage({key, T{}, BatchOp::Erase}); }
+
+        // Reads see the staged changes on top of the container
+        const T* find(size_type key) const {
+            auto it = latest.find(key);
+            if (it != latest.end()) {
+                const Update& update = staged[it->second];
+                return update.op == BatchOp::Erase ? nullptr : &update.value;
+            }
+            if (published != nullptr) {
+                return base->find(key);
+            }
+            return target->contains(key) ? &(*target)[key] : nullptr;
+        }
+
+        bool contains(size_type key) const { return find(key) != nullptr; }
+        size_type staged_count() const { return staged.size(); }
+
+        // In place, with nothrow moves apply_batch() allocates everything it needs before changing
+        // any element and cannot fail afterwards, so the changes are applied directly. Otherwise
+        // they are applied to a copy that replaces the container once complete.
+        // The staged changes are dropped whether or not commit() succeeds.
+        void commit() {
+            try {
+                if (published != nullptr) {
+                    publish();
+                } else if constexpr (std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value) {
+                    target->apply_batch(std::move(staged));
+                } else {
+                    SparseVector updated(*target);
+                    updated.apply_batch(std::move(staged));
+                    *target = std::move(updated);
+                }
+            } catch (...) {
+                rollback();
+                throw;
+            }
+            rollback();
+        }
+
+        void rollback() {
+            staged.clear();
+            latest.clear();
+        }
+    };
+
+    Transaction transaction() { return Transaction(*this); }
+
+    // Transaction that publishes its commit atomically through published; see Transaction
+    static Transaction transaction(std::shared_ptr<const Snapshot>& published) {
+        return Transaction(published);
+    }
+
+    // First published version of contents, for transaction(published)
+    static std::shared_ptr<const Snapshot> publish(SparseVector contents) {
+        return std::make_shared<const Snapshot>(std::move(contents));
+    }
+
+    // Dense renumbering of the occupied indices: values[r] belongs to keys[r], the r-th smallest
+    // occupied index. keys maps rank to key; rank_of() maps back.
+    struct Dense {
+        std::vector<size_type> keys;
+        std::vector<T> values;
+
+        size_type rank_of(size_type key) const {
+            auto it = std::lower_bound(keys.begin(), keys.end(), key);
+            if (it == keys.end() || *it != key) {
+                throw std::out_of_range("SparseVector::Dense::rank_of: key " + std::to_string(key) + " is not present");
+            }
+            return static_cast<size_type>(it - keys.begin());
+        }
+    };
+
+    Dense densify() const& {
+        Dense dense;
+        dense.keys.reserve(objects.size());
+        dense.values.reserve(objects.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].has_value()) {
+                dense.keys.push_back(i);
+                dense.values.push_back(objects[*indices[i]]);
+            }
+        }
+        return dense;
+    }
+
+    // Moves the values out, leaving this container empty. When objects are already stored in key
+    // order (e.g. after build_parallel() or a sorted bulk constructor) the whole vector is handed
+    // over without touching any element.
+    Dense densify() && {
+        Dense dense;
+        dense.keys.reserve(objects.size());
+        bool in_key_order = true;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i].has_value()) {
+                in_key_order &= *indices[i] == dense.keys.size();
+                dense.keys.push_back(i);
+            }
+        }
+        if (in_key_order) {
+            dense.values = std::move(objects);
+        } else {
+            dense.values.reserve(objects.size());
+            for (size_type key : dense.keys) {
+                dense.values.push_back(std::move(objects[*indices[key]]));
+            }
+        }
+        clear();
+        max_index = 0;
+        return dense;
+    }
+
+    // Inverse of densify(): values[r] is stored at index keys[r]
+    static SparseVector sparsify(const std::vector<size_type>& keys, std::vector<T>&& values) {
+        return SparseVector(keys, std::move(values));
+    }
+
+    static SparseVector sparsify(Dense&& dense) {
+        return SparseVector(dense.keys, std::move(dense.values));
+    }
+
+    // Parallel counterpart of copy assignment for large containers. Each thread copy-constructs a
+    // contiguous chunk of objects into its own buffer, so heap memory owned by the copies (e.g.
+    // string or vector buffers) is allocated and first touched by that thread; the buffers are
+    // then moved into place in order, which for such types only steals pointers. Trivially
+    // default constructible objects are instead copied by the threads straight into an array the
+    // calling thread sized (and, being a std::vector, zero filled). Provides the strong exception
+    // guarantee.
+    SparseVector& assign_parallel(const SparseVector& other, unsigned threads = 0) {
+        if (this == &other) {
+            return *this;
+        }
+        std::vector<std::optional<uint32_t>> new_indices(other.indices.size());
+        unsigned index_threads = sparse_parallel::resolve_threads(threads, other.indices.size());
+        sparse_parallel::parallel_for(other.indices.size(), index_threads, [&](size_t begin, size_t end, unsigned) {
+            std::copy(other.indices.begin() + begin, other.indices.begin() + end, new_indices.begin() + begin);
+        });
+
+        size_t n = other.objects.size();
+        size_t min_objects = sparse_parallel::min_parallel_bytes / std::max<size_t>(get_object_memory_usage(), 1);
+        unsigned object_threads = sparse_parallel::resolve_threads(threads, n, min_objects);
+        std::vector<T> new_objects;
+        if constexpr (std::is_trivially_default_constructible<T>::value && std::is_copy_assignable<T>::value) {
+            new_objects.resize(n);
+            sparse_parallel::parallel_for(n, object_threads, [&](size_t begin, size_t end, unsigned) {
+                std::copy(other.objects.begin() + begin, other.objects.begin() + end, new_objects.begin() + begin);
+            });
+        } else {
+            std::vector<std::vector<T>> parts(object_threads);
+            sparse_parallel::parallel_for(n, object_threads, [&](size_t begin, size_t end, unsigned t) {
+                parts[t].assign(other.objects.begin() + begin, other.objects.begin() + end);
+            });
+            new_objects.reserve(n);
+            for (auto& part : parts) {
+                new_objects.insert(new_objects.end(), std::make_move_iterator(part.begin()),
+                                   std::make_move_iterator(part.end()));
+            }
+        }
+
+        objects.swap(new_objects);
+        indices.swap(new_indices);
+        max_index = other.max_index;
+        rank_cache.invalidate();
+        return *this;
+    }
+
+    // Asynchronous bulk operations. Each schedules its work on pool and returns at once; exceptions
+    // surface from the future's get(). Operations reading *this need it to stay alive and
+    // unmodified until the future is ready, and shrink_to_fit_async() needs it untouched as well.
+    static std::future<SparseVector> build_async(std::vector<size_type> keys, std::vector<T>&& values,
+                                                 sparse_parallel::ThreadPool& pool = sparse_parallel::default_pool()) {
+        return pool.submit([keys = std::move(keys), values = std::move(values)]() mutable {
+            return build_parallel(keys, std::move(values), 1);
+        });
+    }
+
+    std::future<SparseVector> copy_async(sparse_parallel::ThreadPool& pool = sparse_parallel::default_pool()) const {
+        return pool.submit([this] { return SparseVector(*this); });
+    }
+
+    std::future<Dense> densify_async(sparse_parallel::ThreadPool& pool = sparse_parallel::default_pool()) const {
+        return pool.submit([this] { return densify(); });
+    }
+
+    template<typename Compare = std::greater<T>>
+    std::future<std::vector<std::pair<size_type, T>>> top_k_async(
+            size_type k, Compare cmp = Compare(),
+            sparse_parallel::ThreadPool& pool = sparse_parallel::default_pool()) const {
+        return pool.submit([this, k, cmp] { return top_k(k, cmp); });
+    }
+
+    std::future<void> shrink_to_fit_async(sparse_parallel::ThreadPool& pool = sparse_parallel::default_pool()) {
+        return pool.submit([this] { shrink_to_fit(); });
+    }
+
+    // Folds every value into init with op, which must be associative and commutative since chunks
+    // of objects are reduced as separate pool jobs. The last job to finish combines the partial
+    // results, so no pool thread ever blocks waiting for another.
+    template<typename Op = std::plus<T>>
+    std::future<T> reduce_async(T init, Op op = Op(),
+                                sparse_parallel::ThreadPool& pool = sparse_parallel::default_pool()) const {
+        struct State {
+            std::vector<std::optional<T>> partials;
+            std::vector<std::exception_ptr> errors;
+            std::atomic<unsigned> remaining;
+            std::promise<T> result;
+            T init;
+            Op op;
+            State(unsigned chunks, T init, Op op)
+                : partials(chunks), errors(chunks), remaining(chunks), init(std::move(init)), op(std::move(op)) {}
+        };
+        size_t n = objects.size();
+        unsigned chunks = sparse_parallel::resolve_threads(pool.size(), n);
+        auto state = std::make_shared<State>(chunks, std::move(init), std::move(op));
+        std::future<T> future = state->result.get_future();
+        size_t chunk = (n + chunks - 1) / chunks;
+        for (unsigned c = 0; c < chunks; ++c) {
+            pool.post([this, state, c, begin = std::min(n, c * chunk), end = std::min(n, (c + 1) * chunk)] {
+                try {
+                    if (begin < end) {
+                        T sum = objects[begin];
+                        for (size_t i = begin + 1; i < end; ++i) {
+                            sum = state->op(std::move(sum), objects[i]);
+                        }
+                        state->partials[c] = std::move(sum);
+                    }
+                } catch (...) {
+                    state->errors[c] = std::current_exception();
+                }
+                if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                    return;
+                }
+                try {
+                    for (auto& error : state->errors) {
+                        if (error) {
+                            std::rethrow_exception(error);
+                        }
+                    }
+                    T total = std::move(state->init);
+                    for (auto& partial : state->partials) {
+                        if (partial.has_value()) {
+                            total = state->op(std::move(total), std::move(*partial));
+                        }
+                    }
+                    state->result.set_value(std::move(total));
+                } catch (...) {
+                    state->result.set_exception(std::current_exception());
+                }
+            });
+        }
+        return future;
     }
 
     void swap(SparseVector& other) {
         objects.swap(other.objects);
         indices.swap(other.indices);
+        rank_cache.invalidate();
+        other.rank_cache.invalidate();
     }
 
     // Lookup
@@ -260,11 +1415,31 @@ class SparseVector {
         return end();
     }
 
+    // Number of occupied indices below pos. O(1) apart from a linear rebuild of the occupancy
+    // bitmap on the first rank()/select() after a modification. Safe to call from several
+    // threads at once.
+    size_type rank(size_type pos) const {
+        build_rank_index();
+        return sparse_bits::rank(rank_cache.words(), rank_cache.blocks(), pos);
+    }
+
+    // The n-th smallest occupied index, counting from zero
+    size_type select(size_type n) const {
+        build_rank_index();
+        size_t total = rank_cache.blocks().back();
+        if (n >= total) {
+            throw std::out_of_range("SparseVector::select: n (which is " + std::to_string(n)
+                                    + ") >= this->size() (which is " + std::to_string(total) + ")");
+        }
+        return sparse_bits::select(rank_cache.words(), rank_cache.blocks(), n);
+    }
+
     // Memory usage calculation
     std::pair<size_t, size_t> memory_usage() const {
         return {
             objects.capacity() * get_object_memory_usage(),
             indices.capacity() * sizeof(std::optional<uint32_t>)
+                + rank_cache.memory_usage()
         };
     }
 };
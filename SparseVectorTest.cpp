@@ -6,7 +6,25 @@
 #include <cassert>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <random>
+#include <cmath>
+#include <set>
+#include <thread>
+#include <atomic>
 #include "SparseVector.hpp"
+#include "SparseSet.hpp"
+#include "InternedSparseVector.hpp"
+#include "SparseStringVector.hpp"
+#include "SparseRunVector.hpp"
+#include "SparseVectorView.hpp"
+#include "QuantizedSparseVector.hpp"
+#include "SparseGrid.hpp"
+#include "SparseBrickGrid.hpp"
+#include "SparseGraph.hpp"
+#include "SparseIngest.hpp"
+#include "MvccSparseVector.hpp"
+#include "HashedSparseVector.hpp"
 
 struct ObjectWithMemoryUsage {
     int data[1000];
@@ -36,6 +54,16 @@ class CustomObject {
     }
 };
 
+struct RelocatableObject {
+    int id;
+    std::vector<int> data;
+
+    RelocatableObject(int i = 0) : id(i), data(16, i) {}
+};
+
+template<>
+struct is_trivially_relocatable<RelocatableObject> : std::true_type {};
+
 void test_basic_operations() {
     std::cout << "Testing basic operations with integers and custom objects...\n";
     SparseVector<int> sv;
@@ -289,12 +317,1516 @@ void test_modifier_operations() {
     std::cout << "Modifier operations test passed.\n\n";
 }
 
+void test_relocatable_erase() {
+    std::cout << "Testing erase with trivially relocatable objects...\n";
+    SparseVector<RelocatableObject> sv;
+
+    for (int i = 0; i < 10; ++i) {
+        sv[i * 3] = RelocatableObject(i);
+    }
+
+    // Erasing from the front, middle and back shifts the tail with memmove
+    sv.erase(0);
+    sv.erase(12);
+    sv.erase(27);
+    assert(sv.size() == 7);
+    assert(!sv.contains(0) && !sv.contains(12) && !sv.contains(27));
+
+    int expected[] = {1, 2, 3, 5, 6, 7, 8};
+    int i = 0;
+    for (const auto& obj : sv) {
+        assert(obj.id == expected[i]);
+        assert(obj.data.size() == 16 && obj.data.back() == expected[i]);
+        ++i;
+    }
+    assert(sv.at(15).id == 5);
+
+    std::cout << "Relocatable erase test passed.\n\n";
+}
+
+void test_sparse_set() {
+    std::cout << "Testing SparseSet...\n";
+    SparseSet set;
+
+    assert(set.empty());
+    assert(set.insert(3));
+    assert(set.insert(64));
+    assert(set.insert(1000));
+    assert(!set.insert(64));
+    assert(set.size() == 3);
+    assert(set.contains(1000) && !set.contains(999));
+
+    std::vector<size_t> keys(set.begin(), set.end());
+    assert((keys == std::vector<size_t>{3, 64, 1000}));
+    assert(*set.find(64) == 64);
+    assert(set.find(65) == set.end());
+
+    assert(set.erase(1000));
+    assert(!set.erase(1000));
+    assert(set.size() == 2);
+
+    SparseSet a{1, 2, 3, 200};
+    SparseSet b{2, 3, 4};
+    assert((a | b) == (SparseSet{1, 2, 3, 4, 200}));
+    assert((a & b) == (SparseSet{2, 3}));
+    assert((a - b) == (SparseSet{1, 200}));
+    assert((a ^ b) == (SparseSet{1, 4, 200}));
+    assert((a & SparseSet{200}).size() == 1);
+
+    std::cout << "SparseSet test passed.\n\n";
+}
+
+void test_interned_values() {
+    std::cout << "Testing InternedSparseVector...\n";
+    InternedSparseVector<std::string> sv;
+
+    for (size_t i = 0; i < 1000; ++i) {
+        sv.insert(i * 2, i % 3 == 0 ? "alpha" : "beta");
+    }
+    assert(sv.size() == 1000);
+    assert(sv.unique_size() == 2);
+    assert(sv[0] == "alpha" && sv[2] == "beta");
+    assert(sv.same_value(0, 6));
+    assert(!sv.same_value(0, 2));
+
+    // Overwriting the last reference to a value frees its slot for reuse
+    sv.insert(1, "gamma");
+    assert(sv.unique_size() == 3);
+    sv.insert(1, "alpha");
+    assert(sv.unique_size() == 2);
+    assert(sv.value_id(1) == sv.value_id(0));
+    sv.insert(3, "delta");
+    assert(sv.unique_size() == 3);
+    sv.erase(3);
+    assert(!sv.contains(3));
+    assert(sv.unique_size() == 2);
+
+    size_t alphas = 0;
+    for (const auto& value : sv) {
+        alphas += value == "alpha";
+    }
+    assert(alphas == 335);
+
+    bool threw = false;
+    try {
+        sv.at(3);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "InternedSparseVector test passed.\n\n";
+}
+
+void test_string_arena() {
+    std::cout << "Testing SparseStringVector...\n";
+    SparseStringVector sv;
+
+    sv.insert(2, "hello");
+    sv.insert(7, "sparse");
+    sv.insert(40, "world");
+    assert(sv.size() == 3);
+    assert(sv[2] == "hello" && sv.at(7) == "sparse" && sv[40] == "world");
+    assert(sv.arena_size() == 16);
+
+    // Shorter values are rewritten in place, longer ones appended
+    sv.insert(7, "svec");
+    assert(sv[7] == "svec");
+    assert(sv.wasted_bytes() == 2);
+    sv.insert(2, "hello, arena");
+    assert(sv[2] == "hello, arena");
+    assert(sv.wasted_bytes() == 7);
+
+    // Values may be copied from another element of the same arena
+    sv.insert(9, sv[2]);
+    assert(sv[9] == "hello, arena");
+
+    sv.erase(7);
+    assert(!sv.contains(7));
+    assert(sv.size() == 3);
+    assert(sv[40] == "world" && sv[9] == "hello, arena");
+
+    sv.compact();
+    assert(sv.wasted_bytes() == 0);
+    assert(sv.arena_size() == 29);
+
+    std::string joined;
+    for (std::string_view value : sv) {
+        joined += value;
+        joined += ';';
+    }
+    assert(joined == "hello, arena;hello, arena;world;");
+
+    std::cout << "SparseStringVector test passed.\n\n";
+}
+
+void test_run_length_values() {
+    std::cout << "Testing SparseRunVector...\n";
+    SparseRunVector<int> sv;
+
+    sv.assign(0, 1000, 7);
+    sv.assign(1000, 2000, 8);
+    assert(sv.size() == 2000);
+    assert(sv.run_count() == 2);
+    assert(sv[999] == 7 && sv[1000] == 8);
+    assert(!sv.contains(2000));
+
+    // Updating the middle of a run splits it, restoring the value merges it back
+    sv.insert(500, 9);
+    assert(sv.run_count() == 4);
+    assert(sv[499] == 7 && sv[500] == 9 && sv[501] == 7);
+    sv.insert(500, 7);
+    assert(sv.run_count() == 2);
+
+    sv.erase(10, 20);
+    assert(sv.size() == 1990);
+    assert(sv.run_count() == 3);
+    assert(!sv.contains(15) && sv.contains(20));
+
+    // Cross-check random updates against std::map
+    SparseRunVector<int> runs;
+    std::map<size_t, int> reference;
+    srand(42);
+    for (int i = 0; i < 2000; ++i) {
+        size_t first = rand() % 300;
+        size_t last = first + rand() % 20;
+        int value = rand() % 3;
+        if (rand() % 4 == 0) {
+            runs.erase(first, last);
+            for (size_t k = first; k < last; ++k) reference.erase(k);
+        } else {
+            runs.assign(first, last, value);
+            for (size_t k = first; k < last; ++k) reference[k] = value;
+        }
+    }
+    assert(runs.size() == reference.size());
+    auto expected = reference.begin();
+    for (auto it = runs.begin(); it != runs.end(); ++it, ++expected) {
+        assert(it.index() == expected->first && *it == expected->second);
+    }
+    for (size_t r = 1; r < runs.runs().size(); ++r) {
+        const auto& prev = runs.runs()[r - 1];
+        const auto& run = runs.runs()[r];
+        assert(prev.end() < run.start || prev.value != run.value);
+    }
+
+    std::cout << "SparseRunVector test passed.\n\n";
+}
+
+void test_rank_select() {
+    std::cout << "Testing rank/select...\n";
+    SparseVector<int> sv;
+    std::vector<size_t> keys;
+
+    for (size_t key = 3; key < 5000; key += 7 + key % 11) {
+        sv[key] = static_cast<int>(key);
+        keys.push_back(key);
+    }
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        assert(sv.select(i) == keys[i]);
+        assert(sv.rank(keys[i]) == i);
+        assert(sv.rank(keys[i] + 1) == i + 1);
+    }
+    assert(sv.rank(0) == 0);
+    assert(sv.rank(100000) == keys.size());
+
+    // Modifications invalidate the cached ranks
+    sv.erase(keys[0]);
+    assert(sv.select(0) == keys[1]);
+    assert(sv.rank(keys[2]) == 1);
+    sv[0] = 1;
+    assert(sv.select(0) == 0);
+
+    bool threw = false;
+    try {
+        sv.select(sv.size());
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    SparseSet set{5, 64, 65, 700, 4096};
+    assert(set.rank(65) == 2 && set.rank(701) == 4);
+    assert(set.select(3) == 700 && set.select(4) == 4096);
+    set.erase(64);
+    assert(set.select(1) == 65);
+
+    // Concurrent queries on const containers share one lazily built index
+    sv[9999] = 1;
+    set.insert(9999);
+    const SparseVector<int>& shared = sv;
+    const SparseSet& shared_set = set;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            assert(shared.rank(100000) == shared.size());
+            assert(shared.select(shared.size() - 1) == 9999);
+            assert(shared_set.rank(100000) == 5);
+            assert(shared_set.select(4) == 9999);
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    // A moved-from container queries as empty, and the target keeps working
+    SparseVector<int> moved = std::move(sv);
+    assert(sv.rank(0) == 0 && sv.rank(100000) == 0);
+    assert(moved.select(0) == 0 && moved.rank(100000) == moved.size());
+    SparseSet moved_set = std::move(set);
+    assert(set.rank(100000) == 0);
+    assert(moved_set.select(0) == 5);
+    sv = moved;
+    assert(sv.rank(100000) == moved.size());
+
+    std::cout << "Rank/select test passed.\n\n";
+}
+
+// Only needs read access to part of the data, so takes a view by value
+int sum_window(SparseVectorView<const int> view) {
+    int sum = 0;
+    for (int value : view) {
+        sum += value;
+    }
+    return sum;
+}
+
+void test_sparse_vector_view() {
+    std::cout << "Testing SparseVectorView...\n";
+    SparseVector<int> sv;
+    sv[2] = 20;
+    sv[5] = 50;
+    sv[9] = 90;
+    sv[14] = 140;
+
+    SparseVectorView<const int> view(sv);
+    assert(view.size() == 4);
+    assert(view[9] == 90 && view.at(14) == 140);
+    assert(sum_window(sv) == 300);
+
+    auto window = view.subview(3, 10);
+    assert(window.size() == 2);
+    assert(window.contains(5) && !window.contains(2) && !window.contains(14));
+    assert(window.find(9).index() == 9);
+    assert(window.find(14) == window.end());
+    assert(sum_window(window) == 140);
+    assert(window.subview(0, 6).size() == 1);
+    assert(view.subview(10, 14).empty());
+
+    bool threw = false;
+    try {
+        window.at(2);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Raw index/object arrays, e.g. from a mapped file
+    std::optional<uint32_t> raw_indices[] = {std::nullopt, 1u, std::nullopt, 0u};
+    int raw_objects[] = {7, 3};
+    SparseVectorView<const int> raw(raw_indices, 4, raw_objects, 2);
+    assert(raw[1] == 3 && raw[3] == 7 && !raw.contains(2));
+    assert(sum_window(raw) == 10);
+
+    std::cout << "SparseVectorView test passed.\n\n";
+}
+
+void test_adopt_and_release() {
+    std::cout << "Testing adopting and releasing buffers...\n";
+    std::vector<RelocatableObject> values = {RelocatableObject(1), RelocatableObject(2), RelocatableObject(3)};
+    const int* first_data = values[0].data.data();
+
+    SparseVector<RelocatableObject> sv({40, 7, 1000}, std::move(values));
+    assert(sv.size() == 3);
+    assert(sv[40].id == 1 && sv[7].id == 2 && sv[1000].id == 3);
+    assert(sv.at(40).data.data() == first_data);  // moved, not copied
+    assert(sv.begin().index() == 7);
+
+    auto [keys, released] = sv.release();
+    assert((keys == std::vector<size_t>{40, 7, 1000}));
+    assert(released.size() == 3 && released[2].id == 3);
+    assert(sv.empty() && !sv.contains(40));
+
+    bool threw = false;
+    try {
+        SparseVector<int> duplicate({1, 1}, std::vector<int>{1, 2});
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Adopt/release test passed.\n\n";
+}
+
+void test_standard_container_conversions() {
+    std::cout << "Testing conversions to and from standard containers...\n";
+    std::map<int, std::string> map = {{3, "three"}, {1, "one"}, {20, "twenty"}};
+
+    SparseVector<std::string> from_map(map);
+    assert(from_map.size() == 3);
+    assert(from_map[1] == "one" && from_map[20] == "twenty");
+    // Sorted input is stored in key order
+    assert(from_map.front() == "one" && from_map.back() == "twenty");
+
+    SparseVector<std::string> moved_map(std::move(map));
+    assert(moved_map[3] == "three");
+
+    std::unordered_map<int, std::string> umap = {{8, "eight"}, {2, "two"}};
+    SparseVector<std::string> from_umap(umap);
+    assert(from_umap.size() == 2 && from_umap[8] == "eight" && from_umap[2] == "two");
+
+    std::vector<std::optional<std::string>> dense(6);
+    dense[0] = "zero";
+    dense[5] = "five";
+    SparseVector<std::string> from_dense(dense);
+    assert(from_dense.size() == 2 && from_dense[5] == "five" && !from_dense.contains(3));
+
+    auto back_to_map = from_map.to_map<int>();
+    assert((back_to_map == std::map<int, std::string>{{1, "one"}, {3, "three"}, {20, "twenty"}}));
+    auto back_to_umap = from_umap.to_unordered_map();
+    assert(back_to_umap.size() == 2 && back_to_umap.at(8) == "eight");
+    auto back_to_dense = from_dense.to_optional_vector();
+    assert(back_to_dense == dense);
+
+    auto moved_out = std::move(from_map).to_map();
+    assert(moved_out.size() == 3 && moved_out.at(20) == "twenty");
+    assert(from_map.empty());
+
+    bool threw = false;
+    try {
+        SparseVector<int> negative(std::map<int, int>{{-1, 0}});
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Standard container conversion test passed.\n\n";
+}
+
+void test_parallel_build() {
+    std::cout << "Testing parallel bulk build...\n";
+    const size_t count = 100000;
+    std::vector<size_t> keys(count);
+    std::vector<int> values(count);
+    std::mt19937 rng(7);
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = rng() % 1000000;
+        values[i] = static_cast<int>(i);
+    }
+    keys[count - 1] = keys[0];  // the later value for a duplicate key wins
+
+    std::map<size_t, int> expected;
+    for (size_t i = 0; i < count; ++i) {
+        expected[keys[i]] = values[i];
+    }
+
+    auto sv = SparseVector<int>::build_parallel(keys, std::move(values), 4);
+    assert(sv.size() == expected.size());
+    assert(sv[keys[0]] == static_cast<int>(count - 1));
+
+    // Values are stored in key order
+    auto it = sv.begin();
+    for (const auto& [key, value] : expected) {
+        assert(it.index() == key && *it == value);
+        ++it;
+    }
+    assert(sv.front() == expected.begin()->second);
+    assert(sv.back() == expected.rbegin()->second);
+
+    auto strings = SparseVector<std::string>::build_parallel({5, 1, 5}, {"a", "b", "c"});
+    assert(strings.size() == 2 && strings[5] == "c" && strings[1] == "b");
+
+    std::cout << "Parallel bulk build test passed.\n\n";
+}
+
+void test_parallel_copy() {
+    std::cout << "Testing parallel copy...\n";
+    SparseVector<CustomObject> sv;
+    for (int i = 0; i < 60000; ++i) {
+        sv[i * 3] = CustomObject(i, "object number " + std::to_string(i));
+    }
+
+    SparseVector<CustomObject> copy(sv, 4);
+    assert(copy.size() == sv.size());
+    for (int i = 0; i < 60000; i += 997) {
+        assert(copy[i * 3] == sv[i * 3]);
+    }
+    assert(!copy.contains(1));
+    copy[1] = CustomObject(1, "only in copy");
+    assert(!sv.contains(1));
+
+    SparseVector<double> doubles;
+    for (int i = 0; i < 300000; ++i) {
+        doubles[i * 2] = i * 0.5;
+    }
+    SparseVector<double> assigned;
+    assigned[7] = 7.0;
+    assigned.assign_parallel(doubles, 3);
+    assert(assigned.size() == doubles.size());
+    assert(!assigned.contains(7));
+    assert(assigned[599998] == 299999 * 0.5);
+    assert(assigned.select(10) == 20);
+
+    std::cout << "Parallel copy test passed.\n\n";
+}
+
+void test_densify() {
+    std::cout << "Testing densify/sparsify...\n";
+    SparseVector<std::string> sv;
+    sv[30] = "c";
+    sv[4] = "a";
+    sv[12] = "b";
+
+    auto dense = sv.densify();
+    assert((dense.keys == std::vector<size_t>{4, 12, 30}));
+    assert((dense.values == std::vector<std::string>{"a", "b", "c"}));
+    assert(dense.rank_of(12) == 1);
+    assert(dense.rank_of(12) == sv.rank(12));
+
+    // Dense kernels work on values by rank, then the result goes back to sparse indices
+    for (auto& value : dense.values) {
+        value += "!";
+    }
+    auto back = SparseVector<std::string>::sparsify(std::move(dense));
+    assert(back.size() == 3 && back[4] == "a!" && back[30] == "c!");
+
+    // Moving out of a key-ordered container hands over the objects vector itself
+    const std::string* first = &back.front();
+    auto moved = std::move(back).densify();
+    assert(&moved.values.front() == first);
+    assert(back.empty());
+
+    bool threw = false;
+    try {
+        moved.rank_of(5);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Densify/sparsify test passed.\n\n";
+}
+
+void test_scatter_gather() {
+    std::cout << "Testing scatter/gather...\n";
+    SparseVector<float> weights;
+    weights[9] = 1.5f;
+    weights[2] = 0.5f;
+    weights[5] = -1.0f;
+
+    std::vector<float> dense(12, 0.0f);
+    weights.scatter_to(dense);
+    assert(dense[2] == 0.5f && dense[5] == -1.0f && dense[9] == 1.5f && dense[0] == 0.0f);
+
+    weights.scatter_add(dense);
+    assert(dense[2] == 1.0f && dense[5] == -2.0f && dense[9] == 3.0f);
+
+    dense[5] = 4.0f;
+    dense[6] = 100.0f;
+    weights.gather_from(dense);
+    assert(weights[2] == 1.0f && weights[5] == 4.0f && weights[9] == 3.0f);
+    assert(!weights.contains(6));
+
+    bool threw = false;
+    std::vector<float> too_small(9);
+    try {
+        weights.scatter_to(too_small);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "Scatter/gather test passed.\n\n";
+}
+
+void test_top_k() {
+    std::cout << "Testing top-k selection...\n";
+    SparseVector<float> scores;
+    scores[10] = 0.3f;
+    scores[3] = 0.9f;
+    scores[77] = 0.1f;
+    scores[42] = 0.7f;
+
+    auto best = scores.top_k(2);
+    assert(best.size() == 2);
+    assert(best[0].first == 3 && best[0].second == 0.9f);
+    assert(best[1].first == 42 && best[1].second == 0.7f);
+
+    auto worst = scores.top_k(3, std::less<float>());
+    assert(worst.size() == 3 && worst[0].first == 77 && worst[2].first == 42);
+    assert(scores.top_k(10).size() == 4);
+    assert(scores.top_k(0).empty());
+
+    SparseVector<int> large;
+    std::mt19937 rng(11);
+    std::vector<int> all;
+    for (size_t i = 0; i < 100000; ++i) {
+        int value = static_cast<int>(rng() % 1000000);
+        large[i * 2 + 1] = value;
+        all.push_back(value);
+    }
+    std::sort(all.begin(), all.end(), std::greater<int>());
+    auto serial = large.top_k(25);
+    auto parallel = large.top_k_parallel(25, 4);
+    assert(serial.size() == 25 && parallel.size() == 25);
+    for (size_t i = 0; i < 25; ++i) {
+        assert(serial[i].second == all[i] && parallel[i].second == all[i]);
+        assert(large[serial[i].first] == serial[i].second);
+        assert(large[parallel[i].first] == parallel[i].second);
+    }
+
+    std::cout << "Top-k test passed.\n\n";
+}
+
+template<typename Encoding>
+void check_quantized(float tolerance) {
+    QuantizedSparseVector<Encoding> sv;
+    SparseVector<float> full;
+    std::vector<float> dense(2000, 0.0f);
+    float expected_sum = 0.0f;
+    float expected_dot = 0.0f;
+    for (size_t i = 0; i < 1000; ++i) {
+        float value = std::sin(static_cast<float>(i)) * 10.0f;
+        sv.insert(i * 2, value);
+        full[i * 2] = value;
+        dense[i * 2] = 0.5f;
+        expected_sum += value;
+        expected_dot += value * 0.5f;
+    }
+    assert(sv.size() == 1000);
+    for (size_t i = 0; i < 1000; ++i) {
+        assert(std::fabs(sv[i * 2] - std::sin(static_cast<float>(i)) * 10.0f) <= tolerance);
+    }
+    assert(std::fabs(sv.sum() - expected_sum) <= tolerance * 1000);
+    assert(std::fabs(sv.dot(dense) - expected_dot) <= tolerance * 1000);
+
+    sv.erase(0);
+    full.erase(0);
+    assert(sv.size() == 999 && !sv.contains(0));
+    assert(std::fabs(sv[1998] - std::sin(999.0f) * 10.0f) <= tolerance);
+    for (size_t i = 1; i < 1000; ++i) {
+        assert(std::fabs(sv[i * 2] - full[i * 2]) <= tolerance);
+    }
+    assert(std::fabs(sv.dot(dense) - expected_dot) <= tolerance * 1000);
+    // Keys past the end of a shorter dense vector contribute nothing
+    std::vector<float> prefix(dense.begin(), dense.begin() + 1000);
+    float expected_prefix = 0.0f;
+    for (size_t i = 1; i < 500; ++i) {
+        expected_prefix += full[i * 2] * 0.5f;
+    }
+    assert(std::fabs(sv.dot(prefix) - expected_prefix) <= tolerance * 500);
+
+    size_t visited = 0;
+    for (auto it = sv.begin(); it != sv.end(); ++it, ++visited) {
+        assert(it.index() % 2 == 0);
+    }
+    assert(visited == 999);
+
+    // The whole footprint, index included, must stay below the unquantised container's
+    auto [value_bytes, index_bytes] = sv.memory_usage();
+    auto [full_value_bytes, full_index_bytes] = full.memory_usage();
+    assert(value_bytes < full_value_bytes);
+    assert(value_bytes + index_bytes < full_value_bytes + full_index_bytes);
+}
+
+void test_quantized_values() {
+    std::cout << "Testing QuantizedSparseVector...\n";
+    check_quantized<Fp16Encoding>(0.01f);
+    check_quantized<Bf16Encoding>(0.05f);
+    check_quantized<Int8BlockEncoding>(0.16f);
+
+    // Exact round trips and special values
+    assert(Fp16Encoding::decode(Fp16Encoding::encode(1.5f)) == 1.5f);
+    assert(Fp16Encoding::decode(Fp16Encoding::encode(-65504.0f)) == -65504.0f);
+    assert(std::isinf(Fp16Encoding::decode(Fp16Encoding::encode(1e6f))));
+    assert(Fp16Encoding::decode(Fp16Encoding::encode(5.9604645e-8f)) == 5.9604645e-8f);
+    assert(Bf16Encoding::decode(Bf16Encoding::encode(-2.0f)) == -2.0f);
+    assert(std::isnan(Bf16Encoding::decode(Bf16Encoding::encode(std::nanf("")))));
+
+    // A large value widens its block's scale and requantises its neighbours
+    QuantizedSparseVector<Int8BlockEncoding> widened;
+    widened.insert(0, 1.0f);
+    widened.insert(1, 100.0f);
+    assert(std::fabs(widened[0] - 1.0f) < 0.5f && std::fabs(widened[1] - 100.0f) < 0.5f);
+
+    std::cout << "QuantizedSparseVector test passed.\n\n";
+}
+
+void test_sparse_grid() {
+    std::cout << "Testing SparseGrid...\n";
+    using Grid = SparseGrid<int, 3>;
+    using Coord = Grid::coord_type;
+
+    Grid grid;
+    assert(grid.key_of({1, 0, 0}) == 1 && grid.key_of({0, 1, 0}) == 2 && grid.key_of({0, 0, 1}) == 4);
+    assert((grid.coord_of(grid.key_of({37, 5, 60})) == Coord{37, 5, 60}));
+    assert((sparse_morton::decode<2>(sparse_morton::encode<2>({123456, 654321})) == std::array<uint32_t, 2>{123456, 654321}));
+    assert((sparse_morton::decode<4>(sparse_morton::encode<4>({1, 200, 3, 4000})) == std::array<uint32_t, 4>{1, 200, 3, 4000}));
+
+    std::set<Coord> cells;
+    std::mt19937 rng(3);
+    for (int i = 0; i < 2000; ++i) {
+        Coord c{static_cast<uint32_t>(rng() % 40), static_cast<uint32_t>(rng() % 40), static_cast<uint32_t>(rng() % 40)};
+        grid[c] = static_cast<int>(c[0] + 100 * c[1] + 10000 * c[2]);
+        cells.insert(c);
+    }
+    assert(grid.size() == cells.size());
+
+    Coord lo{5, 10, 3};
+    Coord hi{21, 30, 17};
+    std::set<Coord> expected;
+    for (const auto& c : cells) {
+        if (c[0] >= lo[0] && c[0] <= hi[0] && c[1] >= lo[1] && c[1] <= hi[1] && c[2] >= lo[2] && c[2] <= hi[2]) {
+            expected.insert(c);
+        }
+    }
+    std::set<Coord> found;
+    uint64_t previous_key = 0;
+    grid.for_each_in_box(lo, hi, [&](const Coord& c, int value) {
+        assert(value == static_cast<int>(c[0] + 100 * c[1] + 10000 * c[2]));
+        assert(found.empty() || grid.key_of(c) > previous_key);  // Morton order
+        previous_key = grid.key_of(c);
+        found.insert(c);
+    });
+    assert(found == expected);
+
+    size_t neighbors = 0;
+    grid[{0, 0, 0}] = 1;
+    grid[{1, 1, 1}] = 2;
+    grid.for_each_neighbor({0, 0, 0}, 1, [&](const Coord& c, int) {
+        assert(c[0] <= 1 && c[1] <= 1 && c[2] <= 1);
+        ++neighbors;
+    });
+    assert(neighbors >= 2);
+
+    bool threw = false;
+    try {
+        grid.contains({Grid::max_coordinate + 1, 0, 0});
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Non-cubic domains only spend key bits on the range each axis uses
+    Grid slab(Coord{1023, 15, 15});
+    assert(slab.key_of({1023, 15, 15}) == (uint64_t{1} << 18) - 1);
+    assert(slab.key_of({1, 0, 0}) == 1 && slab.key_of({0, 1, 0}) == 2 && slab.key_of({0, 0, 1}) == 4);
+    assert((slab.coord_of(slab.key_of({1000, 7, 12})) == Coord{1000, 7, 12}));
+    Grid wide(Coord{4095, 63, 63});
+    wide[{4095, 63, 63}] = 1;
+    assert(wide.storage().memory_usage().second <= (size_t{1} << 24) * sizeof(std::optional<uint32_t>));
+
+    std::set<Coord> slab_cells;
+    for (int i = 0; i < 3000; ++i) {
+        Coord c{static_cast<uint32_t>(rng() % 1024), static_cast<uint32_t>(rng() % 16), static_cast<uint32_t>(rng() % 16)};
+        slab[c] = static_cast<int>(c[0] + 10000 * c[1] + 1000000 * c[2]);
+        slab_cells.insert(c);
+    }
+    Coord slab_lo{100, 3, 0};
+    Coord slab_hi{700, 9, 15};
+    std::set<Coord> slab_expected;
+    for (const auto& c : slab_cells) {
+        if (c[0] >= slab_lo[0] && c[0] <= slab_hi[0] && c[1] >= slab_lo[1] && c[1] <= slab_hi[1]) {
+            slab_expected.insert(c);
+        }
+    }
+    std::set<Coord> slab_found;
+    slab.for_each_in_box(slab_lo, slab_hi, [&](const Coord& c, int value) {
+        assert(value == static_cast<int>(c[0] + 10000 * c[1] + 1000000 * c[2]));
+        slab_found.insert(c);
+    });
+    assert(slab_found == slab_expected);
+
+    threw = false;
+    try {
+        slab.insert({0, 16, 0}, 1);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "SparseGrid test passed.\n\n";
+}
+
+void test_brick_grid() {
+    std::cout << "Testing SparseBrickGrid...\n";
+    using Coord = SparseBrickGrid<float>::coord_type;
+    SparseBrickGrid<float> grid;
+    std::map<Coord, float> expected;
+
+    // A blob of voxels around (100, 100, 100)
+    for (uint32_t x = 96; x < 106; ++x) {
+        for (uint32_t y = 98; y < 102; ++y) {
+            for (uint32_t z = 98; z < 103; ++z) {
+                float value = static_cast<float>(x + y + z);
+                grid.insert({x, y, z}, value);
+                expected[{x, y, z}] = value;
+            }
+        }
+    }
+    assert(grid.size() == expected.size());
+    assert(grid.brick_count() == 2);  // x spans bricks 12 and 13
+    assert(grid.at({100, 100, 100}) == 300.0f);
+    assert(grid.value_or({0, 0, 0}, -1.0f) == -1.0f);
+    assert(!grid.contains({95, 100, 100}));
+
+    std::map<Coord, float> visited;
+    grid.for_each([&](const Coord& c, float value) { visited[c] = value; });
+    assert(visited == expected);
+
+    // Six-point stencil reads through value_or
+    float laplacian = -6.0f * grid.value_or({100, 100, 100}, 0.0f);
+    for (int axis = 0; axis < 3; ++axis) {
+        Coord lo{100, 100, 100};
+        Coord hi{100, 100, 100};
+        --lo[axis];
+        ++hi[axis];
+        laplacian += grid.value_or(lo, 0.0f) + grid.value_or(hi, 0.0f);
+    }
+    assert(laplacian == 0.0f);  // values are linear in x + y + z
+
+    // Emptying a brick drops it
+    for (uint32_t x = 104; x < 106; ++x) {
+        for (uint32_t y = 98; y < 102; ++y) {
+            for (uint32_t z = 98; z < 103; ++z) {
+                grid.erase({x, y, z});
+            }
+        }
+    }
+    assert(grid.brick_count() == 1);
+    assert(grid.size() == expected.size() - 40);
+    assert(grid.brick_at({104, 100, 100}) == nullptr);
+    assert(grid.brick_at({100, 100, 100})->active_count() == grid.size());
+
+    // Voxels past the largest coordinate read as inactive and cannot be inserted
+    constexpr uint32_t far = SparseBrickGrid<float>::max_coordinate;
+    assert(far == (1u << 24) - 1);
+    assert(grid.find({1u << 25, 0, 0}) == nullptr && !grid.contains({0, far + 1, 0}));
+    assert(grid.value_or({1u << 25, 0, 0}, -1.0f) == -1.0f);
+    assert(grid.brick_at({0, 0, 0xffffffffu}) == nullptr);
+    size_t before_far = grid.size();
+    grid.erase({far + 1, 0, 0});
+    bool rejected = false;
+    try {
+        grid.insert({far + 1, 0, 0}, 1.0f);
+    } catch (const std::out_of_range& error) {
+        rejected = std::string(error.what()).find("SparseBrickGrid::insert") != std::string::npos;
+    }
+    assert(rejected && grid.size() == before_far);
+
+    std::cout << "SparseBrickGrid test passed.\n\n";
+}
+
+void test_sparse_graph() {
+    std::cout << "Testing SparseGraph...\n";
+    // Ring over sparse keys 0, 1000, 2000, ... with a chord from the first vertex to the middle
+    const size_t n = 50000;
+    SparseGraphBuilder builder;
+    builder.reserve(n * 2 + 1);
+    for (size_t i = 0; i < n; ++i) {
+        builder.add_undirected_edge(i * 1000, ((i + 1) % n) * 1000);
+    }
+    builder.add_edge(0, (n / 2) * 1000);
+
+    SparseGraph serial = builder.build(1);
+    SparseGraph parallel = builder.build(4);
+    assert(serial.vertex_count() == n);
+    assert(serial.edge_count() == n * 2 + 1);
+    assert(parallel.vertex_count() == n && parallel.edge_count() == serial.edge_count());
+    for (size_t key = 0; key < n * 1000; key += 997 * 1000) {
+        auto a = serial.neighbors(key);
+        auto b = parallel.neighbors(key);
+        assert(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+    }
+
+    // Neighbours keep insertion order
+    std::vector<size_t> around_zero;
+    serial.for_each_neighbor(0, [&](size_t key) { around_zero.push_back(key); });
+    assert((around_zero == std::vector<size_t>{1000, (n - 1) * 1000, (n / 2) * 1000}));
+    assert(serial.degree(5000) == 2);
+    assert(serial.key_of(serial.id_of(7000)) == 7000);
+    assert(!serial.contains(500));
+
+    // The chord halves the distance to the far side of the ring
+    std::map<size_t, uint32_t> depth;
+    uint32_t last_depth = 0;
+    parallel.bfs(0, [&](size_t key, uint32_t d) {
+        assert(d >= last_depth);
+        last_depth = d;
+        depth[key] = d;
+    });
+    assert(depth.size() == n);
+    assert(depth[(n / 2) * 1000] == 1);
+    assert(depth[(n / 4) * 1000] == n / 4);
+    assert(depth[(n / 2 + 3) * 1000] == 4);
+
+    SparseGraphBuilder directed;
+    directed.add_edge(1, 2);
+    SparseGraph path = directed.build();
+    assert(path.neighbors(2).empty());
+    size_t reached = 0;
+    path.bfs(2, [&](size_t, uint32_t) { ++reached; });
+    assert(reached == 1);
+
+    std::cout << "SparseGraph test passed.\n\n";
+}
+
+void test_async_operations() {
+    std::cout << "Testing async operations...\n";
+    sparse_parallel::ThreadPool pool(3);
+    assert(pool.size() == 3);
+
+    const size_t n = 100000;
+    std::vector<size_t> keys(n);
+    std::vector<long> values(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = (i * 7919) % (n * 3);
+        values[i] = static_cast<long>(i);
+    }
+    auto built_future = SparseVector<long>::build_async(keys, std::move(values), pool);
+    SparseVector<long> built = built_future.get();
+    assert(built.size() == n);
+    assert(built[7919] == 1);
+
+    // Start several operations at once, then collect them
+    auto sum = built.reduce_async(0L, std::plus<long>(), pool);
+    auto max = built.reduce_async(-1L, [](long a, long b) { return std::max(a, b); }, pool);
+    auto copy = built.copy_async(pool);
+    auto best = built.top_k_async(2, std::greater<long>(), pool);
+    auto dense = built.densify_async(pool);
+    assert(sum.get() == static_cast<long>(n * (n - 1) / 2));
+    assert(max.get() == static_cast<long>(n - 1));
+    SparseVector<long> copied = copy.get();
+    assert(copied.size() == n && copied[7919] == 1);
+    auto top = best.get();
+    assert(top.size() == 2 && top[0].second == static_cast<long>(n - 1));
+    assert(dense.get().keys.size() == n);
+
+    SparseVector<long> empty;
+    assert(empty.reduce_async(5L, std::plus<long>(), pool).get() == 5);
+    copied.erase(7919);
+    copied.shrink_to_fit_async(pool).get();
+    assert(copied.size() == n - 1);
+
+    // Exceptions reach the caller through the future
+    auto failing = built.reduce_async(0L, [](long a, long b) {
+        if (b == 42) {
+            throw std::runtime_error("bad value");
+        }
+        return a + b;
+    }, pool);
+    bool threw = false;
+    try {
+        failing.get();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    assert(pool.submit([] { return 6 * 7; }).get() == 42);
+
+    std::cout << "Async operations test passed.\n\n";
+}
+
+void test_lazy_items() {
+    std::cout << "Testing lazy item ranges...\n";
+    SparseVector<int> sv;
+    for (int i = 0; i < 20; ++i) {
+        sv[i * 5] = i;
+    }
+
+    // Values are references into the container
+    for (auto [key, value] : sv.items()) {
+        value += static_cast<int>(key);
+    }
+    assert(sv[10] == 12);
+
+    const SparseVector<int>& csv = sv;
+    size_t count = 0;
+    size_t last_key = 0;
+    for (auto [key, value] : csv.items()) {
+        assert(value == static_cast<int>(key / 5 + key));
+        assert(count == 0 || key > last_key);
+        last_key = key;
+        ++count;
+    }
+    assert(count == sv.size());
+    SparseVector<int> empty;
+    assert(empty.items().begin() == empty.items().end());
+
+#ifdef __cpp_lib_ranges
+    // Composes with standard views without materialising anything
+    auto multiples_of_12 = csv.items()
+        | std::views::filter([](const auto& item) { return item.second % 12 == 0; })
+        | std::views::transform([](const auto& item) { return item.first; });
+    std::vector<size_t> keys(multiples_of_12.begin(), multiples_of_12.end());
+    assert(keys.size() == 10);
+    assert(keys.front() == 0 && keys.back() == 90);
+    static_assert(std::ranges::forward_range<decltype(csv.items())>);
+    static_assert(std::ranges::view<decltype(csv.items())>);
+#endif
+#ifdef __cpp_lib_generator
+    size_t streamed = 0;
+    for (auto [key, value] : csv.stream()) {
+        assert(value == csv[key]);
+        ++streamed;
+    }
+    assert(streamed == csv.size());
+#endif
+
+    std::cout << "Lazy item ranges test passed.\n\n";
+}
+
+void test_ingestion_pipeline() {
+    std::cout << "Testing ingestion pipeline...\n";
+    // Single producer ring: wraps around and reports full
+    sparse_ingest::SpscRing<int> spsc(3);
+    assert(spsc.capacity() == 4);
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            int value = round * 10 + i;
+            assert(spsc.try_push(std::move(value)));
+        }
+        int extra = -1;
+        assert(!spsc.try_push(std::move(extra)));
+        std::vector<int> popped;
+        spsc.pop_batch([&](int&& v) { popped.push_back(v); }, 10);
+        assert((popped == std::vector<int>{round * 10, round * 10 + 1, round * 10 + 2, round * 10 + 3}));
+    }
+
+    // Later updates to a key win within a batch
+    IngestionPipeline<int> pipeline(8);
+    SparseVector<int> target;
+    pipeline.submit(5, 1);
+    pipeline.submit(2, 2);
+    pipeline.submit(5, 3);
+    assert(pipeline.drain(target) == 3);
+    assert(target.size() == 2 && target[5] == 3 && target[2] == 2);
+    assert(pipeline.drain(target) == 0);
+
+    // A batch apply_batch rejects is kept for the next drain instead of being lost
+    struct Opaque {
+        int value = 0;
+    };
+    IngestionPipeline<Opaque> opaque_pipeline(8);
+    SparseVector<Opaque> opaque_target;
+    opaque_pipeline.submit(1, Opaque{1});
+    opaque_pipeline.submit({4, Opaque{4}, SparseVector<Opaque>::BatchOp::Combine});
+    bool rejected = false;
+    try {
+        opaque_pipeline.drain(opaque_target);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    assert(rejected && opaque_pipeline.pending() == 2 && opaque_target.empty());
+    opaque_pipeline.submit(7, Opaque{7});
+    auto keep_old = [](Opaque& old, const Opaque&) { return old; };
+    assert(opaque_pipeline.drain(opaque_target, 0, keep_old) == 2);
+    assert(opaque_pipeline.pending() == 0 && opaque_target[1].value == 1 && opaque_target[4].value == 4);
+    assert(opaque_pipeline.drain(opaque_target, 0, keep_old) == 1 && opaque_target[7].value == 7);
+
+    // A default drain takes at most one ring's worth, even while a producer keeps it full
+    IngestionPipeline<int> busy(16);
+    SparseVector<int> busy_target;
+    std::atomic<bool> stop{false};
+    std::thread flood([&] {
+        for (size_t i = 0; !stop; ++i) {
+            busy.try_submit(i % 1000, 1);
+        }
+    });
+    for (int round = 0; round < 100; ++round) {
+        assert(busy.drain(busy_target) <= busy.capacity());
+    }
+    stop = true;
+    flood.join();
+
+    // Several producers racing a draining consumer
+    const unsigned producers = 4;
+    const size_t per_producer = 50000;
+    IngestionPipeline<long> shared(1024);
+    SparseVector<long> result;
+    std::atomic<unsigned> finished{0};
+    std::vector<std::thread> threads;
+    for (unsigned p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (size_t i = 0; i < per_producer; ++i) {
+                shared.submit(i * producers + p, static_cast<long>(i));
+            }
+            ++finished;
+        });
+    }
+    size_t applied = 0;
+    while (finished < producers || applied < producers * per_producer) {
+        applied += shared.drain(result, 256);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(applied == producers * per_producer);
+    assert(result.size() == producers * per_producer);
+    for (size_t key = 0; key < producers * per_producer; key += 9973) {
+        assert(result[key] == static_cast<long>(key / producers));
+    }
+
+    // Single producer pipeline
+    IngestionPipeline<long, sparse_ingest::SpscRing<sparse_ingest::UpdateRecord<long>>> single(64);
+    SparseVector<long> single_result;
+    std::thread producer([&] {
+        for (size_t i = 0; i < 10000; ++i) {
+            single.submit(10000 - i, static_cast<long>(i));
+        }
+    });
+    size_t single_applied = 0;
+    while (single_applied < 10000) {
+        single_applied += single.drain(single_result);
+    }
+    producer.join();
+    assert(single_result.size() == 10000 && single_result[1] == 9999);
+
+    std::cout << "Ingestion pipeline test passed.\n\n";
+}
+
+void test_apply_batch() {
+    std::cout << "Testing apply_batch...\n";
+    using Op = SparseVector<long>::BatchOp;
+    SparseVector<long> sv;
+    std::map<size_t, long> expected;
+    for (size_t i = 0; i < 5000; ++i) {
+        sv[i * 3] = static_cast<long>(i);
+        expected[i * 3] = static_cast<long>(i);
+    }
+
+    // Random mix of operations, with repeated keys, checked against sequential application
+    std::mt19937_64 rng(7);
+    for (int round = 0; round < 4; ++round) {
+        std::vector<SparseVector<long>::Update> updates;
+        for (int i = 0; i < 20000; ++i) {
+            size_t key = rng() % 40000;
+            long value = static_cast<long>(rng() % 1000);
+            Op op = static_cast<Op>(rng() % 3);
+            updates.push_back({key, value, op});
+            if (op == Op::Erase) {
+                expected.erase(key);
+            } else if (op == Op::Combine && expected.count(key) != 0) {
+                expected[key] += value;
+            } else {
+                expected[key] = value;
+            }
+        }
+        if (round % 2 == 0) {
+            sv.apply_batch(std::move(updates));
+        } else {
+            sv.apply_batch(updates);
+        }
+        assert(sv.size() == expected.size());
+        for (const auto& [key, value] : expected) {
+            assert(sv.contains(key) && sv[key] == value);
+        }
+        size_t visited = 0;
+        for (auto it = sv.begin(); it != sv.end(); ++it) {
+            assert(expected.at(it.index()) == *it);
+            ++visited;
+        }
+        assert(visited == expected.size());
+    }
+    assert(sv.rank(20000) == static_cast<size_t>(std::distance(expected.begin(), expected.lower_bound(20000))));
+
+    // Erase then re-insert within one batch, and a custom combine
+    SparseVector<std::string> names;
+    names[1] = "a";
+    names[2] = "b";
+    using StringOp = SparseVector<std::string>::BatchOp;
+    names.apply_batch({{2, "", StringOp::Erase}, {1, "x", StringOp::Combine}, {2, "c", StringOp::Combine},
+                       {7, "", StringOp::Erase}, {1, "y", StringOp::Combine}},
+                      [](const std::string& a, const std::string& b) { return a + "+" + b; });
+    assert(names.size() == 2 && names[1] == "a+x+y" && names[2] == "c");
+    names.apply_batch({{1, "", StringOp::Erase}, {2, "", StringOp::Erase}});
+    assert(names.empty());
+
+    // Overwrites of existing keys never grow full storage; new keys grow it once
+    SparseVector<long> full;
+    for (size_t i = 0; i < 1000; ++i) {
+        full[i] = static_cast<long>(i);
+    }
+    full.shrink_to_fit();
+    size_t full_capacity = full.capacity();
+    full.apply_batch({{5, 42}, {7, 1, Op::Combine}, {5, 43}});
+    assert(full.capacity() == full_capacity && full[5] == 43 && full[7] == 8);
+    full.apply_batch({{3, 0, Op::Erase}, {3, 30}, {2000, 1}});
+    assert(full.size() == 1001 && full[3] == 30 && full[2000] == 1);
+
+    // Erasures of relocatable objects compact by memmove; survivors keep their contents
+    SparseVector<RelocatableObject> relocatable;
+    std::vector<SparseVector<RelocatableObject>::Update> relocatable_updates;
+    for (int i = 0; i < 300; ++i) {
+        relocatable[static_cast<size_t>(i)] = RelocatableObject(i);
+        if (i % 3 != 1) {
+            relocatable_updates.push_back({static_cast<size_t>(i), RelocatableObject(), SparseVector<RelocatableObject>::BatchOp::Erase});
+        }
+    }
+    relocatable_updates.push_back({1000, RelocatableObject(1000)});
+    relocatable.apply_batch(std::move(relocatable_updates));
+    assert(relocatable.size() == 101);
+    for (int i = 1; i < 300; i += 3) {
+        const RelocatableObject& object = relocatable[static_cast<size_t>(i)];
+        assert(object.id == i && object.data.size() == 16 && object.data[15] == i);
+    }
+    assert(relocatable[1000].id == 1000 && relocatable[1000].data[0] == 1000);
+
+    // The pipeline applies erasures too
+    IngestionPipeline<int> pipeline(16);
+    SparseVector<int> target;
+    pipeline.submit(3, 1);
+    pipeline.submit(4, 2);
+    pipeline.submit_erase(3);
+    assert(pipeline.drain(target) == 3);
+    assert(target.size() == 1 && target[4] == 2 && !target.contains(3));
+
+    std::cout << "apply_batch test passed.\n\n";
+}
+
+// Copying throws once copies_left reaches zero; moves may throw too, so transactions copy
+struct FragileObject {
+    static int copies_left;
+    int value = 0;
+
+    FragileObject(int v = 0) : value(v) {}
+    FragileObject(const FragileObject& other) : value(other.value) {
+        if (copies_left-- == 0) {
+            throw std::runtime_error("copy failed");
+        }
+    }
+    FragileObject(FragileObject&& other) : value(other.value) {}
+    FragileObject& operator=(const FragileObject& other) = default;
+    FragileObject& operator=(FragileObject&& other) = default;
+};
+
+int FragileObject::copies_left = 1 << 30;
+
+void test_transactions() {
+    std::cout << "Testing transactions...\n";
+    SparseVector<int> sv;
+    for (int i = 0; i < 10; ++i) {
+        sv[i] = i;
+    }
+
+    auto tx = sv.transaction();
+    tx.insert(3, 30);
+    tx.insert(20, 200);
+    tx.erase(5);
+    tx.erase(99);
+    assert(tx.staged_count() == 4);
+    assert(*tx.find(3) == 30 && *tx.find(20) == 200 && *tx.find(4) == 4);
+    assert(!tx.contains(5) && !tx.contains(99));
+    // Nothing reaches the container before commit
+    assert(sv.size() == 10 && sv[3] == 3 && !sv.contains(20) && sv.contains(5));
+    tx.commit();
+    assert(sv.size() == 10 && sv[3] == 30 && sv[20] == 200 && !sv.contains(5));
+    assert(tx.staged_count() == 0);
+
+    tx.insert(1, -1);
+    tx.rollback();
+    tx.commit();
+    assert(sv[1] == 1);
+    {
+        auto abandoned = sv.transaction();
+        abandoned.erase(1);
+    }
+    assert(sv.contains(1));
+
+    // A failed commit leaves the container as it was
+    SparseVector<FragileObject> fragile;
+    for (int i = 0; i < 100; ++i) {
+        fragile[i] = FragileObject(i);
+    }
+    auto fragile_tx = fragile.transaction();
+    for (int i = 0; i < 100; i += 2) {
+        fragile_tx.erase(i);
+    }
+    fragile_tx.insert(500, FragileObject(5));
+    FragileObject::copies_left = 50;
+    bool threw = false;
+    try {
+        fragile_tx.commit();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    FragileObject::copies_left = 1 << 30;
+    assert(threw);
+    assert(fragile.size() == 100 && !fragile.contains(500));
+    for (int i = 0; i < 100; ++i) {
+        assert(fragile[i].value == i);
+    }
+    assert(fragile_tx.staged_count() == 0);
+    fragile_tx.erase(0);
+    fragile_tx.commit();
+    assert(fragile.size() == 99 && fragile[99].value == 99);
+
+    // Combine updates need a combine that works for the value type
+    bool rejected = false;
+    try {
+        fragile.apply_batch({{1, FragileObject(1), SparseVector<FragileObject>::BatchOp::Combine}});
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    assert(rejected && fragile[1].value == 1);
+
+    // Published transactions: concurrent readers see every commit whole or not at all
+    auto published = SparseVector<int>::publish({});
+    {
+        auto init = SparseVector<int>::transaction(published);
+        for (int i = 0; i < 64; ++i) {
+            init.insert(i, 0);
+        }
+        init.commit();
+    }
+    std::atomic<bool> done{false};
+    std::atomic<size_t> torn{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (!done) {
+                std::shared_ptr<const SparseVector<int>::Snapshot> snapshot = std::atomic_load(&published);
+                int generation = snapshot->at(0);
+                for (int i = 0; i < 64; ++i) {
+                    if (snapshot->at(i) != generation) {
+                        ++torn;
+                    }
+                }
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; ++w) {
+        writers.emplace_back([&] {
+            for (int g = 0; g < 100; ++g) {
+                auto publish_tx = SparseVector<int>::transaction(published);
+                int next = *publish_tx.find(0) + 1;
+                for (int i = 0; i < 64; ++i) {
+                    publish_tx.insert(i, next);
+                }
+                publish_tx.commit();
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    assert(torn == 0);
+    assert(std::atomic_load(&published)->size() == 64);
+
+    auto reading_tx = SparseVector<int>::transaction(published);
+    int before = *reading_tx.find(7);
+    auto other_tx = SparseVector<int>::transaction(published);
+    other_tx.insert(7, -5);
+    other_tx.commit();
+    // Reads stay on the version the transaction started from; the commit applies to the newest
+    assert(*reading_tx.find(7) == before);
+    reading_tx.insert(8, 8);
+    reading_tx.commit();
+    assert(std::atomic_load(&published)->at(7) == -5 && std::atomic_load(&published)->at(8) == 8);
+    assert(*reading_tx.find(7) == -5);
+
+    // Commits stack up as changes over a shared base until they are folded into a new base
+    SparseVector<int> initial;
+    for (int i = 0; i < 10000; ++i) {
+        initial[i] = i;
+    }
+    auto versions = SparseVector<int>::publish(std::move(initial));
+    auto first = std::atomic_load(&versions);
+    {
+        auto small_tx = SparseVector<int>::transaction(versions);
+        small_tx.erase(3);
+        small_tx.insert(20000, 1);
+        small_tx.insert(5, -5);
+        small_tx.commit();
+    }
+    auto second = std::atomic_load(&versions);
+    assert(second->pending_changes() == 3 && second->size() == 10000);
+    assert(!second->contains(3) && second->at(5) == -5 && second->at(20000) == 1 && second->at(6) == 6);
+    assert(first->contains(3) && first->at(5) == 5 && !first->contains(20000));
+    {
+        auto big_tx = SparseVector<int>::transaction(versions);
+        for (int i = 0; i < 5000; ++i) {
+            big_tx.erase(2 * i);
+        }
+        big_tx.commit();
+    }
+    auto folded = std::atomic_load(&versions);
+    assert(folded->pending_changes() == 0 && folded->size() == 5000);
+    assert(!folded->contains(4) && folded->at(7) == 7 && folded->at(20000) == 1);
+    assert(second->pending_changes() == 3 && second->at(4) == 4);
+
+    std::cout << "Transactions test passed.\n\n";
+}
+
+void test_mvcc_snapshots() {
+    std::cout << "Testing MvccSparseVector...\n";
+    MvccSparseVector<std::string> mv;
+    mv.insert(1, "one");
+    mv.insert(100000, "far");
+    auto before = mv.snapshot();
+    mv.insert(1, "uno");
+    mv.erase(100000);
+    mv.commit({{2, std::string("two")}, {3, std::string("three")}, {2, std::nullopt}});
+    assert(mv.size() == 2);
+
+    // The old snapshot still sees the old contents
+    assert(before.at(1) == "one" && before.at(100000) == "far");
+    assert(!before.contains(3) && !before.contains(7));
+    auto after = mv.snapshot();
+    assert(after.version() == mv.version());
+    assert(after.at(1) == "uno" && !after.contains(100000));
+    assert(after.at(3) == "three" && !after.contains(2));
+    std::map<size_t, std::string> seen;
+    after.for_each([&](size_t key, const std::string& value) { seen[key] = value; });
+    assert((seen == std::map<size_t, std::string>{{1, "uno"}, {3, "three"}}));
+    bool threw = false;
+    try {
+        after.at(100000);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Versions stay while a snapshot can reach them
+    size_t stored = mv.version_count();
+    assert(mv.collect() == 0);
+    assert(mv.version_count() == stored);
+    before.release();
+    assert(mv.collect() == 3);  // "one", "far" and "two", which its own commit erased
+    assert(after.at(1) == "uno");
+    mv.insert(1, "ein");
+    after = mv.snapshot();
+    assert(mv.collect() == 1 && after.at(1) == "ein");
+
+    // Readers never see half of a commit: every key holds the same value at every version
+    const size_t keys = 64;
+    MvccSparseVector<long> shared;
+    std::vector<std::pair<size_t, std::optional<long>>> initial;
+    for (size_t k = 0; k < keys; ++k) {
+        initial.emplace_back(k * 1000, 0L);
+    }
+    shared.commit(initial);
+    std::atomic<bool> done{false};
+    std::atomic<size_t> checks{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (!done) {
+                auto snap = shared.snapshot();
+                long first = snap.at(0);
+                for (size_t k = 1; k < keys; ++k) {
+                    assert(snap.at(k * 1000) == first);
+                }
+                ++checks;
+            }
+        });
+    }
+    for (long round = 1; round <= 3000; ++round) {
+        std::vector<std::pair<size_t, std::optional<long>>> changes;
+        for (size_t k = 0; k < keys; ++k) {
+            changes.emplace_back(k * 1000, round);
+        }
+        shared.commit(std::move(changes));
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    assert(checks > 0);
+    shared.collect();
+    assert(shared.version_count() == keys);
+    assert(shared.snapshot().at(5000) == 3000);
+
+    std::cout << "MvccSparseVector test passed.\n\n";
+}
+
+void test_hashed_contents() {
+    std::cout << "Testing HashedSparseVector...\n";
+    HashedSparseVector<std::string> a;
+    HashedSparseVector<std::string> b;
+    assert(a.hash() == b.hash() && a == b);
+
+    // Same contents built in different orders and through different histories
+    a.insert(1, "x");
+    a.insert(50, "y");
+    a.insert(7, "z");
+    b.insert(7, "old");
+    b.insert(50, "y");
+    b.insert(99, "gone");
+    b.insert(1, "x");
+    b.erase(99);
+    b.insert(7, "z");
+    assert(a.hash() == b.hash());
+    assert(a == b);
+    assert(std::hash<HashedSparseVector<std::string>>()(a) == static_cast<size_t>(a.hash()));
+
+    // Swapped values between keys hash differently
+    HashedSparseVector<std::string> swapped;
+    swapped.insert(1, "y");
+    swapped.insert(50, "x");
+    swapped.insert(7, "z");
+    assert(swapped.hash() != a.hash() && swapped != a);
+
+    // modify() keeps the hash in step with the value
+    b.modify(7, [](std::string& value) { value += "!"; });
+    assert(b[7] == "z!" && b != a);
+    b.modify(7, [](std::string& value) { value.pop_back(); });
+    assert(b.hash() == a.hash() && b == a);
+    b.modify(3, [](std::string& value) { value = "new"; });
+    a.insert(3, "new");
+    assert(b.hash() == a.hash() && b == a);
+
+    // Matches a full rehash of a container adopted with the same contents
+    SparseVector<std::string> plain;
+    for (auto it = a.begin(); it != a.end(); ++it) {
+        plain[it.index()] = *it;
+    }
+    HashedSparseVector<std::string> adopted(plain);
+    assert(adopted.hash() == a.hash() && adopted == a);
+
+    a.clear();
+    assert(a.hash() == HashedSparseVector<std::string>().hash() && a.empty());
+
+    std::cout << "HashedSparseVector test passed.\n\n";
+}
+
 int main() {
     test_basic_operations();
     test_memory_usage();
     test_capacity_operations();
     test_modifier_operations();
     test_iterator();
+    test_relocatable_erase();
+    test_sparse_set();
+    test_interned_values();
+    test_string_arena();
+    test_run_length_values();
+    test_rank_select();
+    test_sparse_vector_view();
+    test_adopt_and_release();
+    test_standard_container_conversions();
+    test_parallel_build();
+    test_parallel_copy();
+    test_densify();
+    test_scatter_gather();
+    test_top_k();
+    test_quantized_values();
+    test_sparse_grid();
+    test_brick_grid();
+    test_sparse_graph();
+    test_async_operations();
+    test_lazy_items();
+    test_ingestion_pipeline();
+    test_apply_batch();
+    test_transactions();
+    test_mvcc_snapshots();
+    test_hashed_contents();
 
 
 
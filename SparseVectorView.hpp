@@ -0,0 +1,173 @@
+#ifndef SPARSEVECTORVIEW_HPP_
+#define SPARSEVECTORVIEW_HPP_
+
+#include <optional>
+#include <stdexcept>
+#include <iterator>
+#include <limits>
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <cstdint>
+#include "SparseVector.hpp"
+
+// Non-owning, read-only view of SparseVector storage, optionally restricted to the index window
+// [first, last). It only holds pointers, so it is cheap to copy and pass by value, and it can
+// also be pointed at an index/object layout that lives elsewhere (e.g. a memory-mapped file).
+// Views are invalidated by anything that reallocates the underlying storage.
+template<typename T>
+class SparseVectorView {
+  public:
+    using element_type = std::remove_const_t<T>;
+    using value_type = element_type;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = const element_type&;
+    using const_reference = const element_type&;
+    using pointer = const element_type*;
+    using const_pointer = const element_type*;
+
+    static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+  private:
+    const std::optional<uint32_t>* indices = nullptr;
+    const element_type* objects = nullptr;
+    size_t object_count = 0;
+    size_t index_count = 0;
+    size_t first = 0;
+    size_t last = 0;
+
+  public:
+    // Iterators copy the view's pointers, so they stay valid after the view itself is gone
+    class Iterator {
+      private:
+        const std::optional<uint32_t>* indices;
+        const element_type* objects;
+        size_t current_index;
+        size_t last;
+
+        void advance_to_valid() {
+            while (current_index < last && !indices[current_index].has_value()) {
+                ++current_index;
+            }
+        }
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = const element_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = value_type*;
+        using reference = value_type&;
+
+        Iterator(const SparseVectorView* view, size_t index)
+            : indices(view->indices), objects(view->objects), current_index(index), last(view->last) {
+            advance_to_valid();
+        }
+
+        reference operator*() const {
+            return objects[*indices[current_index]];
+        }
+
+        pointer operator->() const {
+            return &(operator*());
+        }
+
+        // Sparse index of the current element
+        size_type index() const {
+            return current_index;
+        }
+
+        Iterator& operator++() {
+            ++current_index;
+            advance_to_valid();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return indices == other.indices && current_index == other.current_index;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    using iterator = Iterator;
+    using const_iterator = Iterator;
+
+    const_iterator begin() const { return const_iterator(this, first); }
+    const_iterator cbegin() const { return const_iterator(this, first); }
+    const_iterator end() const { return const_iterator(this, last); }
+    const_iterator cend() const { return const_iterator(this, last); }
+
+    // Constructors
+    SparseVectorView() = default;
+
+    // Views raw storage laid out like SparseVector's: index_size slots mapping indices to
+    // positions in objects
+    SparseVectorView(const std::optional<uint32_t>* index_data, size_type index_size,
+                     const element_type* object_data, size_type objects_size)
+        : indices(index_data), objects(object_data), object_count(objects_size), index_count(index_size),
+          first(0), last(index_size) {}
+
+    SparseVectorView(const SparseVector<element_type>& sv)
+        : SparseVectorView(sv.indices.data(), sv.indices.size(), sv.objects.data(), sv.objects.size()) {}
+
+    // View of the indices in [from, to), clamped to this view's window
+    SparseVectorView subview(size_type from, size_type to = npos) const {
+        SparseVectorView result = *this;
+        result.first = std::min(std::max(from, first), last);
+        result.last = std::max(std::min(to, last), result.first);
+        return result;
+    }
+
+    // Element access
+    const element_type& at(size_type pos) const {
+        if (!contains(pos)) {
+            throw std::out_of_range("SparseVectorView::at: pos (which is " + std::to_string(pos)
+                                    + ") is not set in [" + std::to_string(first) + ", "
+                                    + std::to_string(last) + ")");
+        }
+        return objects[*indices[pos]];
+    }
+
+    const element_type& operator[](size_type pos) const {
+        return at(pos);
+    }
+
+    // Capacity
+    bool empty() const { return begin() == end(); }
+
+    // Number of elements in the window; O(1) for an unrestricted view, else linear in the window
+    size_type size() const {
+        if (first == 0 && last == index_count) {
+            return object_count;
+        }
+        size_type count = 0;
+        for (size_t i = first; i < last; ++i) {
+            count += indices[i].has_value();
+        }
+        return count;
+    }
+
+    // Bounds of the index window
+    size_type first_index() const { return first; }
+    size_type last_index() const { return last; }
+
+    // Lookup
+    bool contains(size_type pos) const {
+        return pos >= first && pos < last && indices[pos].has_value();
+    }
+
+    const_iterator find(size_type pos) const {
+        return contains(pos) ? const_iterator(this, pos) : end();
+    }
+};
+
+#endif //SPARSEVECTORVIEW_HPP_
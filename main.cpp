@@ -8,7 +8,12 @@
 #include <optional>
 #include <cstdint>
 #include <iomanip>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
 #include "SparseVector.hpp"
+#include "SparseIngest.hpp"
 
 struct LargeObject {
     int id;
@@ -21,6 +26,10 @@ struct LargeObject {
     }
 };
 
+// LargeObject only owns a vector header, so SparseVector may move it with memmove
+template<>
+struct is_trivially_relocatable<LargeObject> : std::true_type {};
+
 template<typename T>
 size_t get_memory_usage(const T& container) {
     if constexpr (std::is_same<T, std::vector<std::optional<LargeObject>>>::value) {
@@ -126,6 +135,79 @@ void runTest(const std::string& name, T& container, const std::vector<int>& ids)
 }
 
 
+// Producers push random (key, value) updates while the main thread applies them to a SparseVector,
+// once through a mutex protected deque and once through the lock-free ingestion pipeline
+void runIngestionBenchmark(unsigned producers, size_t updatesPerProducer, size_t maxKey) {
+    using Clock = std::chrono::high_resolution_clock;
+    size_t total = producers * updatesPerProducer;
+    auto produce = [&](unsigned p, auto&& push) {
+        std::mt19937_64 rng(p);
+        for (size_t i = 0; i < updatesPerProducer; ++i) {
+            push(static_cast<size_t>(rng() % maxKey), static_cast<int>(i));
+        }
+    };
+    auto report = [&](const std::string& name, Clock::time_point start, const SparseVector<int>& target) {
+        auto time = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+        std::cout << name << " ingestion: " << time << " microseconds, "
+                  << (total / std::max<double>(time, 1.0)) << " M updates/s, "
+                  << target.size() << " distinct keys\n";
+    };
+
+    {
+        std::mutex mutex;
+        std::deque<std::pair<size_t, int>> queue;
+        SparseVector<int> target;
+        auto start = Clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                produce(p, [&](size_t key, int value) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    queue.emplace_back(key, value);
+                });
+            });
+        }
+        size_t applied = 0;
+        std::vector<std::pair<size_t, int>> batch;
+        while (applied < total) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                batch.assign(queue.begin(), queue.end());
+                queue.clear();
+            }
+            for (const auto& [key, value] : batch) {
+                target[key] = value;
+            }
+            applied += batch.size();
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        report("Mutex deque", start, target);
+    }
+
+    {
+        IngestionPipeline<int> pipeline(size_t{1} << 16);
+        SparseVector<int> target;
+        auto start = Clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                produce(p, [&](size_t key, int value) { pipeline.submit(key, value); });
+            });
+        }
+        size_t applied = 0;
+        while (applied < total) {
+            applied += pipeline.drain(target, 8192);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        report("Lock-free pipeline", start, target);
+    }
+    std::cout << "\n";
+}
+
 std::vector<int> generateUniqueRandomIDs(int count, int maxID) {
     std::vector<int> ids(maxID);
     std::iota(ids.begin(), ids.end(), 1);
@@ -151,5 +233,7 @@ int main() {
     runTest("Unordered Map", umap, ids);
     runTest("Sparse Vector", svec, ids);
 
+    runIngestionBenchmark(4, 500000, 1 << 22);
+
     return 0;
 }
\ No newline at end of file